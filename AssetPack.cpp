@@ -0,0 +1,112 @@
+#include "AssetPack.hpp"
+#include "data_path.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+constexpr uint32_t AssetPack::Alignment;
+
+AssetPack::AssetPack(std::string const &filename) : file(filename) {
+	Header header;
+	if (file.size < sizeof(Header)) {
+		throw std::runtime_error("Asset pack '" + filename + "' is too small to have a header.");
+	}
+	std::memcpy(&header, file.data, sizeof(Header));
+	if (std::string(header.magic, 4) != "apk0") {
+		throw std::runtime_error("Asset pack '" + filename + "' has the wrong magic number.");
+	}
+	uint64_t toc_size = uint64_t(header.entry_count) * sizeof(Entry) + header.names_size;
+	if (file.size - sizeof(Header) < toc_size) {
+		throw std::runtime_error("Asset pack '" + filename + "' has a truncated table of contents.");
+	}
+	uint8_t const *toc = file.data + sizeof(Header);
+	if (crc32(toc, size_t(toc_size)) != header.toc_crc) {
+		throw std::runtime_error("Asset pack '" + filename + "' has a corrupt table of contents.");
+	}
+	char const *names = reinterpret_cast< char const * >(toc + header.entry_count * sizeof(Entry));
+
+	files.reserve(header.entry_count);
+	for (uint32_t i = 0; i < header.entry_count; ++i) {
+		Entry entry;
+		std::memcpy(&entry, toc + i * sizeof(Entry), sizeof(Entry));
+		if (!(entry.name_begin <= entry.name_end && entry.name_end <= header.names_size)) {
+			throw std::runtime_error("Asset pack '" + filename + "' has an entry with out-of-range name begin/end.");
+		}
+		std::string name(names + entry.name_begin, names + entry.name_end);
+		if (entry.offset > file.size || file.size - entry.offset < entry.size) {
+			throw std::runtime_error("Asset pack '" + filename + "' has out-of-range data for '" + name + "'.");
+		}
+		Span< uint8_t > bytes;
+		bytes.data = file.data + entry.offset;
+		bytes.size = size_t(entry.size);
+		if (crc32(bytes.data, bytes.size) != entry.crc) {
+			throw std::runtime_error("Asset pack '" + filename + "' has corrupt data for '" + name + "'.");
+		}
+		if (!files.empty() && !(files.back().first < name)) {
+			throw std::runtime_error("Asset pack '" + filename + "' has unsorted (or duplicate) names.");
+		}
+		files.emplace_back(name, bytes);
+	}
+}
+
+Span< uint8_t > const *AssetPack::find(std::string const &name) const {
+	auto f = std::lower_bound(files.begin(), files.end(), name, [](std::pair< std::string, Span< uint8_t > > const &a, std::string const &b) {
+		return a.first < b;
+	});
+	if (f == files.end() || f->first != name) return nullptr;
+	return &f->second;
+}
+
+uint32_t AssetPack::crc32(uint8_t const *data, size_t size) {
+	static uint32_t const *table = [](){
+		static uint32_t table[256];
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for (uint32_t k = 0; k < 8; ++k) {
+				c = (c & 1) ? (0xedb88320U ^ (c >> 1)) : (c >> 1);
+			}
+			table[n] = c;
+		}
+		return table;
+	}();
+	uint32_t crc = 0xffffffffU;
+	for (size_t i = 0; i < size; ++i) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc ^ 0xffffffffU;
+}
+
+//------------------
+
+namespace {
+	std::unique_ptr< AssetPack > &mounted_pack() {
+		static std::unique_ptr< AssetPack > pack;
+		return pack;
+	}
+}
+
+bool mount_asset_pack(std::string const &filename) {
+	if (!std::ifstream(filename, std::ios::binary)) return false;
+	mounted_pack().reset(new AssetPack(filename));
+	return true;
+}
+
+DataFile open_data_file(std::string const &filename) {
+	DataFile ret;
+	if (AssetPack const *pack = mounted_pack().get()) {
+		//pack names are relative to the data directory:
+		static std::string const prefix = data_path("");
+		std::string name = filename;
+		if (name.compare(0, prefix.size(), prefix) == 0) name = name.substr(prefix.size());
+		if (Span< uint8_t > const *bytes = pack->find(name)) {
+			ret.bytes = *bytes;
+			return ret;
+		}
+	}
+	ret.loose.reset(new MappedFile(filename));
+	ret.bytes.data = ret.loose->data;
+	ret.bytes.size = ret.loose->size;
+	return ret;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+//"AssetPack" holds many data files in one file (built by meshes/pack-assets.py), so that loading them
+// takes one open and one mapping, and -- since files are stored in the order they are listed when building,
+// ideally the order they are loaded -- reads the disk front-to-back.
+//Layout (little-endian):
+//  header: 'apk0', entry count, size of names, crc32 of the table of contents and names
+//  table of contents: one Entry per file, sorted by name
+//  names
+//  file contents, each starting at a multiple of Alignment bytes (so chunks can be used in place)
+
+struct AssetPack {
+	//map 'filename' and check its table of contents and the crc32 of every file in it:
+	// (checking reads the whole pack, front-to-back, which also brings it into memory for loading)
+	// note: will throw if the file can't be mapped or is malformed, or if any crc32 doesn't match.
+	AssetPack(std::string const &filename);
+	AssetPack(AssetPack const &) = delete;
+
+	//contents of the file named 'name' (relative to the data directory, e.g. "crates.pnc"), or nullptr if not in the pack:
+	Span< uint8_t > const *find(std::string const &name) const;
+
+	struct Header {
+		char magic[4]; //'apk0'
+		uint32_t entry_count;
+		uint32_t names_size;
+		uint32_t toc_crc; //crc32 of the entries and names
+	};
+	static_assert(sizeof(Header) == 16, "Header is packed.");
+
+	struct Entry {
+		uint32_t name_begin, name_end; //within names
+		uint64_t offset; //from start of pack
+		uint64_t size;
+		uint32_t crc; //crc32 of contents
+		uint32_t padding;
+	};
+	static_assert(sizeof(Entry) == 32, "Entry is packed.");
+
+	static constexpr uint32_t Alignment = 64;
+
+	//crc32 (the zlib / PNG polynomial) of 'size' bytes at 'data':
+	static uint32_t crc32(uint8_t const *data, size_t size);
+
+	//internals:
+	MappedFile file;
+	std::vector< std::pair< std::string, Span< uint8_t > > > files; //sorted by name
+};
+
+//Loaders open data files through open_data_file(), which uses the mounted pack (if any) before the file system:
+
+//mount 'filename' (e.g., data_path("assets.pack")) for the rest of the program, if it exists:
+// returns false if there is no such file.
+// note: will throw if the file exists but isn't a valid pack (see AssetPack::AssetPack).
+bool mount_asset_pack(std::string const &filename);
+
+//contents of a data file: a view into the mounted pack, or -- for files not in the pack -- a mapping of the file:
+struct DataFile {
+	Span< uint8_t > bytes;
+	std::unique_ptr< MappedFile > loose; //(null if the data is in the pack)
+};
+
+//open 'filename' (a path made with data_path(), or relative to the data directory):
+// note: will throw if the file isn't in the mounted pack and can't be mapped.
+DataFile open_data_file(std::string const &filename);
@@ -8,6 +8,9 @@
 #include "Sound.hpp"
 #include "WalkMesh.hpp"
 #include "Enemy.hpp"
+#include "StaticBatch.hpp"
+#include "WorkerPool.hpp"
+#include "SpatialIndex.hpp"
 
 #include <SDL.h>
 #include <glm/glm.hpp>
@@ -39,6 +42,9 @@ struct CratesMode : public Mode {
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) override;
 
+	//prepare_draw snapshots the scene (see Scene::prepare_draw) for drawing on the render thread:
+	virtual std::function< void() > prepare_draw(glm::uvec2 const &drawable_size) override;
+
 	//starts up a 'quit/resume' pause menu:
 	void show_pause_menu();
 
@@ -47,6 +53,9 @@ struct CratesMode : public Mode {
 
 	void initiate_game();
 
+	//adds an enemy (and puts it in the spatial index):
+	void spawn_enemy(vec3 const &position);
+
 	struct {
 		bool forward = false;
 		bool backward = false;
@@ -56,8 +65,18 @@ struct CratesMode : public Mode {
 
 	bool mouse_captured = false;
 
+	//(declared before scene, since scene removes objects from it as they are deleted)
+	SpatialIndex spatial_index{2.0f}; //buttons + enemies, for proximity tests against the player
+	enum SpatialLayers : uint32_t {
+		ButtonLayer = 1,
+		EnemyLayer = 2
+	};
+	std::vector< Scene::Object * > nearby; //scratch space for spatial_index queries
+
 	Scene scene;
+	WorkerPool worker_pool; //used by scene.draw() to compute object matrices
 	Scene::Camera *camera = nullptr;
+	uint32_t vertex_color_material = -1U; //index in scene.materials
 
 	WalkMesh walk_mesh = WalkMesh({}, {});
 	WalkMesh::WalkPoint walk_point;
@@ -90,12 +109,32 @@ struct CratesMode : public Mode {
 		NONE = '0', FLAT = 'F', SLOPE = 'S'
 	};
 
-	std::vector<Scene::Object *> platforms;
+	//after generation, platforms are baked into platform_batch; 'platforms' holds one object per batch chunk:
+	std::vector<Scene::ObjectHandle> platforms;
+	StaticBatch platform_batch;
+	GLuint platform_batch_vao = 0;
+	uint32_t platform_commands = -1U; //scene command list holding the platform chunks
 	PlatformType platform_types[MAP_WIDTH][MAP_HEIGHT][MAP_LEVELS];
 	
-	std::vector<Scene::Object *> buttons;
+	std::vector<Scene::ObjectHandle> buttons;
 	std::vector<Enemy> enemies;
 
+	//scene draw counts, accumulated over a game (reported by show_end_screen):
+	struct OcclusionStats {
+		uint64_t drawn = 0;
+		uint64_t culled = 0;
+		uint64_t frames = 0;
+	} occlusion_stats;
+
+	//shaded samples (see Scene::count_samples) per draw order setting, accumulated over a game (also reported by show_end_screen):
+	// indexed by (sort_front_to_back ? 1 : 0) + (depth_prepass ? 2 : 0), as set for the measured draw;
+	// 'frames' counts the frames whose draw was measured
+	struct FillStats {
+		uint64_t samples = 0;
+		uint64_t pixels = 0;
+		uint64_t frames = 0;
+	} fill_stats[4];
+
 	//when this reaches zero, the 'dot' sample is triggered at the small crate:
 	float dot_countdown = 1.0f;
 
@@ -11,8 +11,6 @@
 
 #define PI 3.14159265f
 
-#define ENEMY_WIDTH 0.35f
-
 using namespace glm;
 
 const quat rotations[] = {
@@ -28,39 +26,60 @@ const vec3 units[] = {
 };
 
 Load< MeshBuffer > enemy_meshes(LoadTagDefault, [](){
-	return new MeshBuffer(data_path("enemies.pnc"));
+	return new MeshBuffer(data_path("enemies.pnc"), MeshBuffer::UploadOnly, MeshBuffer::SharedArena); //(shares a vao with platforms)
 });
 
 Load< GLuint > enemy_meshes_for_vertex_color_program(LoadTagDefault, [](){
 	return new GLuint(enemy_meshes->make_vao_for_program(vertex_color_program->program));
 });
 
+//levels of detail for the enemy mesh ('Enemy', plus 'Enemy_LOD1', ... if present), switching every 12 units:
+Load< std::vector< Scene::Object::LOD > > enemy_lods(LoadTagDefault, [](){
+	std::vector< Scene::Object::LOD > *ret = new std::vector< Scene::Object::LOD >();
+	for (MeshBuffer::Mesh const &mesh : enemy_meshes->lookup_lods("Enemy")) {
+		if (ret->size() == Scene::Object::MaxLODs) break;
+		Scene::Object::LOD lod;
+		lod.start = mesh.start;
+		lod.count = mesh.count;
+		lod.distance = 12.0f * ret->size();
+		ret->emplace_back(lod);
+	}
+	return ret;
+});
+
 Load< Sound::Sample > enemy_sound(LoadTagDefault, [](){
 	return new Sound::Sample(data_path("drone.wav"));
 });
 
-Enemy::Enemy(Scene &scene, vec3 pos) {
+Enemy::Enemy(Scene &scene, uint32_t material, vec3 pos) {
 
-	transform = scene.new_transform();
+	Scene::Transform *transform = scene.new_transform();
 	transform->position = pos;
 	transform->scale = vec3(1.5f, 1.5f, 1.5f);
+	this->transform = scene.handle(transform);
 
-	object = scene.new_object(transform);
-	object->program = vertex_color_program->program;
-	object->program_mvp_mat4 = vertex_color_program->object_to_clip_mat4;
-	object->program_mv_mat4x3 = vertex_color_program->object_to_light_mat4x3;
-	object->program_itmv_mat3 = vertex_color_program->normal_to_light_mat3;
+	Scene::Object *object = scene.new_object(transform);
+	this->object = scene.handle(object);
+	object->material = material;
 	object->vao = *enemy_meshes_for_vertex_color_program;
 	MeshBuffer::Mesh const &mesh = enemy_meshes->lookup("Enemy");
 	object->start = mesh.start;
 	object->count = mesh.count;
+	object->indexed = mesh.indexed;
+	object->position_offset = mesh.position_offset;
+	object->position_scale = mesh.position_scale;
+	for (Scene::Object::LOD const &lod : *enemy_lods) {
+		object->lods[object->lod_count++] = lod;
+	}
 
 	dir = POS_X;
 
 	loop = enemy_sound->play(transform->position, 0.5f, Sound::Loop);
 }
 
-bool Enemy::update(float elapsed, vec3 player_pos, std::mt19937 &rnd) {
+void Enemy::update(Scene &scene, float elapsed, vec3 player_pos, std::mt19937 &rnd) {
+	Scene::Transform *transform = scene.lookup(this->transform);
+	if (!transform) return; //(deleted along with the scene's contents)
 	transform->position += units[dir] * elapsed;
 	transform->rotation = rotations[dir];
 
@@ -106,9 +125,4 @@ bool Enemy::update(float elapsed, vec3 player_pos, std::mt19937 &rnd) {
 
 	glm::mat4 pos_to_world = transform->make_local_to_world();
 	loop->set_position( pos_to_world * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) );
-
-	if (abs(dif.x) < ENEMY_WIDTH && abs(dif.y) < ENEMY_WIDTH && abs(dif.z) < ENEMY_WIDTH) {
-		return true;
-	}
-	return false;
 }
\ No newline at end of file
@@ -8,8 +8,12 @@
 
 using namespace glm;
 
+//half-size of the box around an enemy that catches the player:
+#define ENEMY_WIDTH 0.35f
+
 struct Enemy {
-	Enemy(Scene &scene, vec3 pos = vec3(0,0,0));
+	//'material' is the index of a vertex_color_program material in scene.materials:
+	Enemy(Scene &scene, uint32_t material, vec3 pos = vec3(0,0,0));
 
 	enum Direction {
 		POS_Z = 0,
@@ -20,10 +24,12 @@ struct Enemy {
 		NEG_Y = 5
 	};
 
-	bool update(float elapsed, vec3 player_pos, std::mt19937 &rnd);
+	//move (steering toward player_pos); catching the player is checked by the caller:
+	void update(Scene &scene, float elapsed, vec3 player_pos, std::mt19937 &rnd);
 
-	Scene::Transform * transform = nullptr;
-	Scene::Object * object = nullptr;
+	//(handles, since the scene may delete these out from under the enemy -- see Scene::Handle)
+	Scene::TransformHandle transform;
+	Scene::ObjectHandle object;
 	Direction dir;
 
 	std::shared_ptr< Sound::PlayingSample > loop;
@@ -174,38 +174,21 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 		);
 	}
 
-	//set up graphics pipeline to use data from the meshes and the simple shading program:
-	glBindVertexArray(*meshes_for_vertex_color_program);
-	glUseProgram(vertex_color_program->program);
-
-	glUniform3fv(vertex_color_program->sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.81f, 0.81f, 0.76f)));
-	glUniform3fv(vertex_color_program->sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f))));
-	glUniform3fv(vertex_color_program->sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.3f)));
-	glUniform3fv(vertex_color_program->sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 1.0f, 0.0f)));
-
-	//helper function to draw a given mesh with a given transformation:
-	auto draw_mesh = [&](MeshBuffer::Mesh const &mesh, glm::mat4 const &object_to_world) {
-		//set up the matrix uniforms:
-		if (vertex_color_program->object_to_clip_mat4 != -1U) {
-			glm::mat4 object_to_clip = world_to_clip * object_to_world;
-			glUniformMatrix4fv(vertex_color_program->object_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
-		}
-		if (vertex_color_program->object_to_light_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(vertex_color_program->object_to_light_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_world));
-		}
-		if (vertex_color_program->normal_to_light_mat3 != -1U) {
-			//NOTE: if there isn't any non-uniform scaling in the object_to_world matrix, then the inverse transpose is the matrix itself, and computing it wastes some CPU time:
-			glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(object_to_world)));
-			glUniformMatrix3fv(vertex_color_program->normal_to_light_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_world));
-		}
-
-		//draw the mesh:
-		glDrawArrays(GL_TRIANGLES, mesh.start, mesh.count);
-	};
-
+	//set up per-frame uniforms (camera + lighting):
+	Scene::FrameUniforms frame;
+	frame.world_to_clip = world_to_clip;
+	frame.sun_color = glm::vec4(0.81f, 0.81f, 0.76f, 0.0f);
+	frame.sun_direction = glm::vec4(glm::normalize(glm::vec3(-0.2f, 0.2f, 1.0f)), 0.0f);
+	frame.sky_color = glm::vec4(0.2f, 0.2f, 0.3f, 0.0f);
+	frame.sky_direction = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+	frame_block.set(&frame, sizeof(frame), Scene::FrameBinding);
+
+	//gather everything to draw, so per-object matrices can be written in one pass:
+	std::vector< std::pair< MeshBuffer::Mesh const *, glm::mat4 > > draws;
+	draws.reserve(2 * board_size.x * board_size.y + 1);
 	for (uint32_t y = 0; y < board_size.y; ++y) {
 		for (uint32_t x = 0; x < board_size.x; ++x) {
-			draw_mesh(tile_mesh,
+			draws.emplace_back(&tile_mesh,
 				glm::mat4(
 					1.0f, 0.0f, 0.0f, 0.0f,
 					0.0f, 1.0f, 0.0f, 0.0f,
@@ -213,7 +196,7 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 					x+0.5f, y+0.5f,-0.5f, 1.0f
 				)
 			);
-			draw_mesh(*board_meshes[y*board_size.x+x],
+			draws.emplace_back(board_meshes[y*board_size.x+x],
 				glm::mat4(
 					1.0f, 0.0f, 0.0f, 0.0f,
 					0.0f, 1.0f, 0.0f, 0.0f,
@@ -224,7 +207,7 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 			);
 		}
 	}
-	draw_mesh(cursor_mesh,
+	draws.emplace_back(&cursor_mesh,
 		glm::mat4(
 			1.0f, 0.0f, 0.0f, 0.0f,
 			0.0f, 1.0f, 0.0f, 0.0f,
@@ -233,6 +216,26 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 		)
 	);
 
+	object_ring.begin(uint32_t(draws.size()), sizeof(Scene::ObjectUniforms));
+	for (uint32_t i = 0; i < draws.size(); ++i) {
+		glm::mat4 const &object_to_world = draws[i].second;
+		Scene::ObjectUniforms *block = reinterpret_cast< Scene::ObjectUniforms * >(object_ring.block(i));
+		block->object_to_light = object_to_world;
+		//NOTE: if there isn't any non-uniform scaling in the object_to_world matrix, then the inverse transpose is the matrix itself, and computing it wastes some CPU time:
+		block->normal_to_light = glm::mat3x4(glm::inverse(glm::transpose(glm::mat3(object_to_world))));
+	}
+	object_ring.end();
+
+	//set up graphics pipeline to use data from the meshes and the simple shading program:
+	glBindVertexArray(*meshes_for_vertex_color_program);
+	glUseProgram(vertex_color_program->program);
+
+	for (uint32_t i = 0; i < draws.size(); ++i) {
+		object_ring.bind(Scene::ObjectBinding, i);
+		draws[i].first->draw();
+	}
+	object_ring.fence();
+
 	if (Mode::current.get() == this) {
 		glDisable(GL_DEPTH_TEST);
 		std::string message = "PRESS ESC FOR MENU";
@@ -4,6 +4,7 @@
 
 #include "MeshBuffer.hpp"
 #include "GL.hpp"
+#include "UniformBuffers.hpp"
 
 #include <SDL.h>
 #include <glm/glm.hpp>
@@ -46,4 +47,8 @@ struct GameMode : public Mode {
 		bool roll_down = false;
 	} controls;
 
+	//------- drawing -------
+
+	UniformBlock frame_block; //camera + lighting
+	UniformRing object_ring; //per-object matrices
 };
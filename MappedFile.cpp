@@ -0,0 +1,99 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(std::string const &filename) {
+	file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		file_handle = nullptr;
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size)) {
+		CloseHandle(file_handle);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size == 0) return; //(can't map empty files)
+	mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping_handle) data = reinterpret_cast< uint8_t const * >(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		if (mapping_handle) CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+}
+#else
+MappedFile::MappedFile(std::string const &filename) {
+	fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(info.st_size);
+	if (size == 0) return; //(can't map empty files)
+	void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED) {
+		close(fd);
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	madvise(mapped, size, MADV_SEQUENTIAL); //(chunks are read front-to-back)
+	data = reinterpret_cast< uint8_t const * >(mapped);
+}
+
+MappedFile::~MappedFile() {
+	if (data) munmap(const_cast< uint8_t * >(data), size);
+	if (fd != -1) close(fd);
+}
+#endif
+
+uint8_t const *ChunkReader::next_chunk(std::string const &magic, size_t element_size, size_t *size) {
+	struct ChunkHeader {
+		char magic[4];
+		uint32_t size;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	if (offset > bytes.size || bytes.size - offset < sizeof(ChunkHeader)) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	ChunkHeader header;
+	std::memcpy(&header, bytes.data + offset, sizeof(header));
+	if (std::string(header.magic,4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk");
+	}
+	if (header.size % element_size != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	if (bytes.size - offset - sizeof(ChunkHeader) < header.size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+	uint8_t const *data = bytes.data + offset + sizeof(ChunkHeader);
+	offset += sizeof(ChunkHeader) + header.size;
+	*size = header.size;
+	return data;
+}
+
+std::string ChunkReader::peek_chunk() const {
+	if (offset > bytes.size || bytes.size - offset < 4) return "";
+	return std::string(reinterpret_cast< char const * >(bytes.data + offset), 4);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+//"MappedFile" maps a whole (read-only) file into memory, so that its contents can be used in place
+// (e.g., uploaded to OpenGL straight from the mapped pages, with no intermediate buffer to fill or zero):
+struct MappedFile {
+	//note: will throw if the file can't be opened or mapped.
+	MappedFile(std::string const &filename);
+	~MappedFile();
+	MappedFile(MappedFile const &) = delete;
+
+	uint8_t const *data = nullptr; //(nullptr for empty files)
+	size_t size = 0;
+
+	//internals:
+	#ifdef _WIN32
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+	#else
+	int fd = -1;
+	#endif
+};
+
+//"Span" refers to 'size' elements stored elsewhere (e.g., in a MappedFile):
+template< typename T >
+struct Span {
+	T const *data = nullptr;
+	size_t size = 0;
+
+	T const &operator[](size_t i) const { return data[i]; }
+	T const *begin() const { return data; }
+	T const *end() const { return data + size; }
+	bool empty() const { return size == 0; }
+};
+
+//"ChunkReader" walks the chunks of a mapped file -- or of any bytes in memory, e.g. an AssetPack entry -- (same layout as read_chunk.hpp reads):
+struct ChunkReader {
+	ChunkReader(MappedFile const &file) { bytes.data = file.data; bytes.size = file.size; }
+	ChunkReader(Span< uint8_t > const &bytes_) : bytes(bytes_) { }
+
+	//refer to the next chunk's contents in place, and move past it:
+	// note: will throw if the chunk is truncated, has the wrong magic number, isn't a multiple of sizeof(T),
+	//  or isn't aligned for T (chunks following odd-sized chunks may not be; use read_chunk for those).
+	template< typename T >
+	Span< T > map_chunk(std::string const &magic);
+
+	//copy the next chunk's contents into a vector, and move past it:
+	// note: will throw in the same cases as map_chunk, except for alignment.
+	template< typename T >
+	void read_chunk(std::string const &magic, std::vector< T > *to);
+
+	//magic number of the next chunk, or "" if there are no more chunks:
+	std::string peek_chunk() const;
+
+	bool at_end() const { return offset >= bytes.size; }
+
+	Span< uint8_t > bytes;
+	size_t offset = 0; //start of next chunk
+
+	//(shared by map_chunk and read_chunk) check header, return chunk data and size, and move past it:
+	uint8_t const *next_chunk(std::string const &magic, size_t element_size, size_t *size);
+};
+
+template< typename T >
+Span< T > ChunkReader::map_chunk(std::string const &magic) {
+	Span< T > ret;
+	size_t size = 0;
+	uint8_t const *data = next_chunk(magic, sizeof(T), &size);
+	if (reinterpret_cast< uintptr_t >(data) % alignof(T) != 0) {
+		throw std::runtime_error("Chunk data is not aligned.");
+	}
+	ret.data = reinterpret_cast< T const * >(data);
+	ret.size = size / sizeof(T);
+	return ret;
+}
+
+template< typename T >
+void ChunkReader::read_chunk(std::string const &magic, std::vector< T > *to) {
+	size_t size = 0;
+	uint8_t const *data = next_chunk(magic, sizeof(T), &size);
+	to->resize(size / sizeof(T));
+	if (size) std::memcpy(to->data(), data, size);
+}
@@ -3,17 +3,14 @@
 #include "Load.hpp"
 #include "compile_program.hpp"
 #include "MeshBuffer.hpp"
-#include "data_path.hpp"
+#include "draw_text.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
 #include <iostream>
 
 //---------- resources ------------
-Load< MeshBuffer > menu_meshes(LoadTagInit, [](){
-	return new MeshBuffer(data_path("menu.p"));
-});
-
+//(glyphs come from draw_text's font, text_meshes)
 
 //Uniform locations in menu_program:
 GLint menu_program_mvp = -1;
@@ -42,9 +39,9 @@ Load< GLuint > menu_program(LoadTagInit, [](){
 	return ret;
 });
 
-//Binding for using menu_program on menu_meshes:
+//Binding for using menu_program on text_meshes:
 Load< GLuint > menu_binding(LoadTagDefault, [](){
-	return new GLuint(menu_meshes->make_vao_for_program(*menu_program));
+	return new GLuint(text_meshes->make_vao_for_program(*menu_program));
 });
 
 GLint fade_program_color = -1;
@@ -201,8 +198,7 @@ void MenuMode::draw(glm::uvec2 const &drawable_size) {
 				glUniformMatrix4fv(menu_program_mvp, 1, GL_FALSE, glm::value_ptr(mvp));
 				glUniform3f(menu_program_color, 1.0f, 1.0f, 1.0f);
 
-				MeshBuffer::Mesh const &mesh = menu_meshes->lookup(label.substr(i,1));
-				glDrawArrays(GL_TRIANGLES, mesh.start, mesh.count);
+				text_glyph(label[i]).draw();
 			}
 
 			x += width(label[i]);
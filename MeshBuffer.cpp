@@ -1,38 +1,72 @@
 #include "MeshBuffer.hpp"
-#include "read_chunk.hpp"
+#include "MappedFile.hpp"
+#include "AssetPack.hpp"
+#include "VertexArena.hpp"
 
 #include <glm/glm.hpp>
 
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
-#include <set>
+#include <map>
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
+#include <cmath>
+
+MeshBuffer::MeshBuffer(std::string const &filename, DataRetention retention, Placement placement) {
+	//chunks are used in place (uploaded straight from the mapped file or asset pack):
+	DataFile file = open_data_file(filename);
+	FileData data = read(file.bytes, filename, retention);
+
+	//upload vertices (and indices) to this buffer's own vbo (and ebo), or append them to a shared arena:
+	if (placement == SharedArena) {
+		arena = &VertexArena::acquire(*this, vertex_count, index_count);
+		vbo = arena->vbo;
+		ebo = arena->ebo;
+		first_vertex = arena->add_vertices(data.vertices, vertex_count);
+		first_index = arena->add_indices(data.indices, index_count, first_vertex);
+		for (auto &mesh : meshes) {
+			mesh.start += (mesh.indexed ? first_index : first_vertex); //(meshes start at offsets within the arena)
+		}
+	} else {
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, vertex_count * Position.stride, data.vertices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (data.indexed) {
+			glGenBuffers(1, &ebo);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * sizeof(GLuint), data.indices, GL_STATIC_DRAW);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		}
+	}
 
-MeshBuffer::MeshBuffer(std::string const &filename) {
-	glGenBuffers(1, &vbo);
+}
 
-	std::ifstream file(filename, std::ios::binary);
+MeshBuffer::FileData MeshBuffer::read(Span< uint8_t > const &bytes, std::string const &filename, DataRetention retention) {
+	ChunkReader chunks(bytes);
 
 	GLuint total = 0;
-	//read + upload data chunk:
+	void const *vertex_data = nullptr;
+	//read data chunk:
 	if (filename.size() >= 2 && filename.substr(filename.size()-2) == ".p") {
 		struct Vertex {
 			glm::vec3 Position;
 		};
 		static_assert(sizeof(Vertex) == 3*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "p...", &data);
+		Span< Vertex > data = chunks.map_chunk< Vertex >("p...");
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		vertex_data = data.data; //(uploaded below)
 
-		total = GLuint(data.size()); //store total for later checks on index
+		total = GLuint(data.size); //store total for later checks on index
+
+		if (retention == KeepCPUCopy) {
+			cpu_data.assign(reinterpret_cast< uint8_t const * >(data.begin()), reinterpret_cast< uint8_t const * >(data.end()));
+		}
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
@@ -44,15 +78,15 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pn..", &data);
+		Span< Vertex > data = chunks.map_chunk< Vertex >("pn..");
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		vertex_data = data.data; //(uploaded below)
 
-		total = GLuint(data.size()); //store total for later checks on index
+		total = GLuint(data.size); //store total for later checks on index
+
+		if (retention == KeepCPUCopy) {
+			cpu_data.assign(reinterpret_cast< uint8_t const * >(data.begin()), reinterpret_cast< uint8_t const * >(data.end()));
+		}
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
@@ -66,15 +100,15 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4+4*1, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pnc.", &data);
+		Span< Vertex > data = chunks.map_chunk< Vertex >("pnc.");
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		vertex_data = data.data; //(uploaded below)
 
-		total = GLuint(data.size()); //store total for later checks on index
+		total = GLuint(data.size); //store total for later checks on index
+
+		if (retention == KeepCPUCopy) {
+			cpu_data.assign(reinterpret_cast< uint8_t const * >(data.begin()), reinterpret_cast< uint8_t const * >(data.end()));
+		}
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
@@ -90,15 +124,15 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4+4*1+2*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pnct", &data);
+		Span< Vertex > data = chunks.map_chunk< Vertex >("pnct");
 
-		//upload data:
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		vertex_data = data.data; //(uploaded below)
+
+		total = GLuint(data.size); //store total for later checks on index
 
-		total = GLuint(data.size()); //store total for later checks on index
+		if (retention == KeepCPUCopy) {
+			cpu_data.assign(reinterpret_cast< uint8_t const * >(data.begin()), reinterpret_cast< uint8_t const * >(data.end()));
+		}
 
 		//store attrib locations:
 		Position = Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
@@ -106,12 +140,117 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
 		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
 
+	} else if (filename.size() >= 4 && filename.substr(filename.size()-4) == ".pnq") {
+		//quantized variants (see MeshBuffer::Mesh::position_offset):
+		struct Vertex {
+			glm::u16vec3 Position;
+			uint16_t padding;
+			uint32_t Normal;
+		};
+		static_assert(sizeof(Vertex) == 3*2+2+4, "Vertex is packed.");
+
+		Span< Vertex > data = chunks.map_chunk< Vertex >("PN..");
+
+		vertex_data = data.data; //(uploaded below)
+
+		total = GLuint(data.size); //store total for later checks on index
+
+		if (retention == KeepCPUCopy) {
+			cpu_data.assign(reinterpret_cast< uint8_t const * >(data.begin()), reinterpret_cast< uint8_t const * >(data.end()));
+		}
+
+		//store attrib locations:
+		Position = Attrib(3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Position));
+		Normal = Attrib(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Normal));
+
+	} else if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pncq") {
+		struct Vertex {
+			glm::u16vec3 Position;
+			uint16_t padding;
+			uint32_t Normal;
+			glm::u8vec4 Color;
+		};
+		static_assert(sizeof(Vertex) == 3*2+2+4+4*1, "Vertex is packed.");
+
+		Span< Vertex > data = chunks.map_chunk< Vertex >("PNc.");
+
+		vertex_data = data.data; //(uploaded below)
+
+		total = GLuint(data.size); //store total for later checks on index
+
+		if (retention == KeepCPUCopy) {
+			cpu_data.assign(reinterpret_cast< uint8_t const * >(data.begin()), reinterpret_cast< uint8_t const * >(data.end()));
+		}
+
+		//store attrib locations:
+		Position = Attrib(3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Position));
+		Normal = Attrib(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+
+	} else if (filename.size() >= 6 && filename.substr(filename.size()-6) == ".pnctq") {
+		struct Vertex {
+			glm::u16vec3 Position;
+			uint16_t padding;
+			uint32_t Normal;
+			glm::u8vec4 Color;
+			glm::vec2 TexCoord;
+		};
+		static_assert(sizeof(Vertex) == 3*2+2+4+4*1+2*4, "Vertex is packed.");
+
+		Span< Vertex > data = chunks.map_chunk< Vertex >("PNct");
+
+		vertex_data = data.data; //(uploaded below)
+
+		total = GLuint(data.size); //store total for later checks on index
+
+		if (retention == KeepCPUCopy) {
+			cpu_data.assign(reinterpret_cast< uint8_t const * >(data.begin()), reinterpret_cast< uint8_t const * >(data.end()));
+		}
+
+		//store attrib locations:
+		Position = Attrib(3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Position));
+		Normal = Attrib(4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+
 	} else {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	bool quantized = (Position.type == GL_UNSIGNED_SHORT);
+
+	vertex_count = total;
+
+	//read (optional) index chunk:
+	bool indexed = false;
+	Span< GLuint > indices;
+	if (chunks.peek_chunk() == "ind0") {
+		indices = chunks.map_chunk< GLuint >("ind0");
+		for (auto i : indices) {
+			if (i >= total) throw std::runtime_error("index chunk has out-of-range vertex index");
+		}
+
+		indexed = true;
+		index_count = GLuint(indices.size);
+		total = index_count; //(meshes are ranges of indices)
+
+		if (retention == KeepCPUCopy) {
+			cpu_indices.assign(indices.begin(), indices.end());
+		}
+	}
+
+	//read (required, for quantized files) box chunk:
+	struct Box {
+		glm::vec3 offset;
+		glm::vec3 scale;
+	};
+	static_assert(sizeof(Box) == 24, "Box should be packed");
+	std::vector< Box > boxes;
+	if (quantized) {
+		chunks.read_chunk("qbox", &boxes);
+	}
+
+	Span< char > strings = chunks.map_chunk< char >("str0");
 
 	{ //read index chunk, add to meshes:
 		struct IndexEntry {
@@ -121,91 +260,226 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
 		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		chunks.read_chunk("idx0", &index); //(copied, since it may not be aligned after 'str0')
+
+		if (quantized && boxes.size() != index.size()) {
+			throw std::runtime_error("box chunk should have one box per index entry");
+		}
 
-		for (auto const &entry : index) {
-			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
+		for (uint32_t i = 0; i < index.size(); ++i) {
+			IndexEntry const &entry = index[i];
+			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size)) {
 				throw std::runtime_error("index entry has out-of-range name begin/end");
 			}
 			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
-				throw std::runtime_error("index entry has out-of-range vertex start/count");
+				throw std::runtime_error("index entry has out-of-range vertex (or index) start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+			std::string name(strings.data + entry.name_begin, strings.data + entry.name_end);
 			Mesh mesh;
 			mesh.start = entry.vertex_begin;
 			mesh.count = entry.vertex_end - entry.vertex_begin;
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
-				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+			mesh.indexed = indexed;
+			if (quantized) {
+				mesh.position_offset = boxes[i].offset;
+				mesh.position_scale = boxes[i].scale;
+			}
+			names.emplace_back(name, Handle(meshes.size()));
+			meshes.emplace_back(mesh);
+		}
+
+		//read (optional) bounds chunk, or compute bounds from the vertex data:
+		if (chunks.peek_chunk() == "bnd0") {
+			std::vector< Bounds > bounds;
+			chunks.read_chunk("bnd0", &bounds); //(copied, since it may not be aligned after 'str0')
+			if (bounds.size() != index.size()) {
+				throw std::runtime_error("bounds chunk should have one entry per index entry");
+			}
+			for (uint32_t i = 0; i < meshes.size(); ++i) {
+				meshes[i].bounds = bounds[i];
+			}
+		} else {
+			uint8_t const *vertices = reinterpret_cast< uint8_t const * >(vertex_data);
+			for (uint32_t i = 0; i < meshes.size(); ++i) {
+				//object-space position of the n'th vertex (or element) of the mesh:
+				auto position = [&](GLuint n) {
+					GLuint v = index[i].vertex_begin + n;
+					if (indexed) v = indices[v];
+					uint8_t const *at = vertices + v * Position.stride;
+					if (quantized) {
+						glm::u16vec3 q;
+						std::memcpy(&q, at, sizeof(q));
+						return boxes[i].offset + boxes[i].scale * glm::vec3(q) * (1.0f / 65535.0f);
+					} else {
+						glm::vec3 p;
+						std::memcpy(&p, at, sizeof(p));
+						return p;
+					}
+				};
+				Mesh &mesh = meshes[i];
+				Bounds &b = mesh.bounds;
+				if (mesh.count == 0) continue;
+				b.min = b.max = position(0);
+				for (GLuint n = 1; n < mesh.count; ++n) {
+					glm::vec3 p = position(n);
+					b.min = glm::min(b.min, p);
+					b.max = glm::max(b.max, p);
+				}
+				b.center = 0.5f * (b.min + b.max);
+				float radius2 = 0.0f;
+				for (GLuint n = 0; n < mesh.count; ++n) {
+					glm::vec3 d = position(n) - b.center;
+					radius2 = std::max(radius2, glm::dot(d, d));
+				}
+				b.radius = std::sqrt(radius2);
+				b.triangle_count = mesh.count / 3;
+				for (GLuint t = 0; t < b.triangle_count; ++t) {
+					glm::vec3 a = position(3*t);
+					b.surface_area += 0.5f * glm::length(glm::cross(position(3*t+1) - a, position(3*t+2) - a));
+				}
+			}
+		}
+
+		//sort the name table (keeping the first of any duplicate names, which find() will return):
+		std::stable_sort(names.begin(), names.end(), [](std::pair< std::string, Handle > const &a, std::pair< std::string, Handle > const &b) {
+			return a.first < b.first;
+		});
+		for (uint32_t i = 1; i < names.size(); ++i) {
+			if (names[i].first == names[i-1].first) {
+				std::cerr << "WARNING: mesh name '" + names[i].first + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
 			}
 		}
 	}
 
-	if (file.peek() != EOF) {
+	if (!chunks.at_end()) {
 		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
 	}
 
 	/* //DEBUG:
 	std::cout << "File '" << filename << "' contained meshes";
-	for (auto const &m : meshes) {
-		if (&m.second == &meshes.rbegin()->second && meshes.size() > 1) std::cout << " and";
-		std::cout << " '" << m.first << "'";
-		if (&m.second != &meshes.rbegin()->second) std::cout << ",";
+	for (auto const &n : names) {
+		if (&n == &names.back() && names.size() > 1) std::cout << " and";
+		std::cout << " '" << n.first << "'";
+		if (&n != &names.back()) std::cout << ",";
 	}
 	std::cout << std::endl;
 	*/
+
+	FileData data;
+	data.vertices = vertex_data;
+	data.indexed = indexed;
+	data.indices = indices.data;
+	return data;
 }
 
-const MeshBuffer::Mesh &MeshBuffer::lookup(std::string const &name) const {
-	auto f = meshes.find(name);
-	if (f == meshes.end()) {
+MeshBuffer::Handle MeshBuffer::find(std::string const &name) const {
+	auto f = std::lower_bound(names.begin(), names.end(), name, [](std::pair< std::string, Handle > const &a, std::string const &b) {
+		return a.first < b;
+	});
+	if (f == names.end() || f->first != name) return -1U;
+	return f->second;
+}
+
+MeshBuffer::Handle MeshBuffer::lookup_handle(std::string const &name) const {
+	Handle handle = find(name);
+	if (handle == -1U) {
 		throw std::runtime_error("Looking up mesh '" + name + "' that doesn't exist.");
 	}
-	return f->second;
+	return handle;
+}
+
+const MeshBuffer::Mesh &MeshBuffer::lookup(std::string const &name) const {
+	return meshes[lookup_handle(name)];
+}
+
+std::vector< MeshBuffer::Mesh > MeshBuffer::lookup_lods(std::string const &name) const {
+	std::vector< Mesh > ret;
+	ret.emplace_back(lookup(name));
+	while (true) {
+		Handle handle = find(name + "_LOD" + std::to_string(ret.size()));
+		if (handle == -1U) break;
+		ret.emplace_back(meshes[handle]);
+	}
+	return ret;
+}
+
+//attribute locations of programs used with make_vao_for_program (queried once per program):
+namespace {
+	struct ProgramAttribs {
+		MeshBuffer::AttribLocations locations; //of "Position", "Normal", "Color", "TexCoord" (-1 if not active)
+		std::vector< std::pair< std::string, GLint > > active; //all active attributes
+	};
+	ProgramAttribs const &program_attribs(GLuint program) {
+		static std::map< GLuint, ProgramAttribs > cache;
+		auto f = cache.find(program);
+		if (f != cache.end()) return f->second;
+
+		ProgramAttribs &attribs = cache[program];
+		attribs.locations[0] = glGetAttribLocation(program, "Position");
+		attribs.locations[1] = glGetAttribLocation(program, "Normal");
+		attribs.locations[2] = glGetAttribLocation(program, "Color");
+		attribs.locations[3] = glGetAttribLocation(program, "TexCoord");
+
+		GLint active = 0;
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active);
+		assert(active >= 0 && "Doesn't makes sense to have negative active attributes.");
+		for (GLuint i = 0; i < GLuint(active); ++i) {
+			GLchar name[100];
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
+			name[99] = '\0';
+			attribs.active.emplace_back(name, glGetAttribLocation(program, name));
+		}
+		return attribs;
+	}
 }
 
 GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
+	ProgramAttribs const &program_info = program_attribs(program);
+
+	//locations this buffer's attributes bind to:
+	MeshBuffer::Attrib const *attribs[4] = { &Position, &Normal, &Color, &TexCoord };
+	static char const *names[4] = { "Position", "Normal", "Color", "TexCoord" };
+	AttribLocations locations;
+	for (uint32_t a = 0; a < 4; ++a) {
+		locations[a] = (attribs[a]->size == 0 ? -1 : program_info.locations[a]); //(empty attribs aren't bound)
+	}
+
+	//Check that all active attributes will be bound:
+	for (auto const &active : program_info.active) {
+		if (active.second == -1 || std::find(locations.begin(), locations.end(), active.second) == locations.end()) {
+			throw std::runtime_error("ERROR: active attribute '" + active.first + "' in program is not bound.");
+		}
+	}
+
+	//buffers in an arena share the arena's vaos (all their vaos would be identical):
+	std::map< AttribLocations, GLuint > &cache = (arena ? arena->vaos : vaos);
+	auto f = cache.find(locations);
+	if (f != cache.end()) return f->second;
+
 	//create a new vertex array object:
 	GLuint vao = 0;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	//Try to bind all attributes in this buffer:
-	std::set< GLuint > bound;
+	//Bind all attributes in this buffer:
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	auto bind_attribute = [&](char const *name, MeshBuffer::Attrib const &attrib) {
-		if (attrib.size == 0) return; //don't bind empty attribs
-		GLint location = glGetAttribLocation(program, name);
-		if (location == -1) {
-			std::cerr << "WARNING: attribute '" << name << "' in mesh buffer isn't active in program." << std::endl;
+	for (uint32_t a = 0; a < 4; ++a) {
+		MeshBuffer::Attrib const &attrib = *attribs[a];
+		if (attrib.size == 0) continue; //don't bind empty attribs
+		if (locations[a] == -1) {
+			std::cerr << "WARNING: attribute '" << names[a] << "' in mesh buffer isn't active in program." << std::endl;
 		} else {
-			glVertexAttribPointer(location, attrib.size, attrib.type, attrib.normalized, attrib.stride, (GLbyte *)0 + attrib.offset);
-			glEnableVertexAttribArray(location);
-			bound.insert(location);
+			glVertexAttribPointer(locations[a], attrib.size, attrib.type, attrib.normalized, attrib.stride, (GLbyte *)0 + attrib.offset);
+			glEnableVertexAttribArray(locations[a]);
 		}
-	};
-	bind_attribute("Position", Position);
-	bind_attribute("Normal", Normal);
-	bind_attribute("Color", Color);
-	bind_attribute("TexCoord", TexCoord);
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if (ebo != 0) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo); //(element buffer binding is part of the vao's state)
 	glBindVertexArray(0);
+	if (ebo != 0) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	//Check that all active attributes were bound:
-	GLint active = 0;
-	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &active);
-	assert(active >= 0 && "Doesn't makes sense to have negative active attributes.");
-	for (GLuint i = 0; i < GLuint(active); ++i) {
-		GLchar name[100];
-		GLint size = 0;
-		GLenum type = 0;
-		glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
-		name[99] = '\0';
-		GLint location = glGetAttribLocation(program, name);
-		if (!bound.count(GLuint(location))) {
-			throw std::runtime_error("ERROR: active attribute '" + std::string(name) + "' in program is not bound.");
-		}
-	}
+	cache.emplace(locations, vao);
 
 	return vao;
 }
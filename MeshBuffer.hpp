@@ -1,13 +1,26 @@
 #pragma once
 
 #include "GL.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <array>
 #include <map>
+#include <cassert>
+
+struct VertexArena;
+template< typename T > struct Span;
 
 //"MeshBuffer" holds a collection of meshes loaded from a file
 // (note that meshes in a single collection will share a vbo/vao)
+//Files may be indexed (export-meshes.py writes an 'ind0' chunk after the vertex data);
+// then meshes are ranges of 32-bit indices, and the vaos made by make_vao_for_program include the element buffer.
+//Files may also be quantized ('.pnq', '.pncq', '.pnctq'): 16-bit positions (fractions of a per-mesh box, listed in a 'qbox' chunk)
+// and GL_INT_2_10_10_10_REV normals, for 12-20 byte vertices instead of 24-36 bytes.
 
 struct MeshBuffer {
 	GLuint vbo = 0; //OpenGL vertex buffer object containing the meshes' data
+	GLuint ebo = 0; //OpenGL element buffer object containing indices into vbo (zero unless file is indexed)
 
 	//Attrib includes location within the vertex buffer of various attributes:
 	// (exactly the parameters to glVertexAttribPointer)
@@ -31,21 +44,110 @@ struct MeshBuffer {
 
 	//construct from a file:
 	// note: will throw if file fails to read.
-	MeshBuffer(std::string const &filename);
+	// if 'retention' is KeepCPUCopy, a copy of the vertex data is kept in 'cpu_data' (e.g., for StaticBatch).
+	// if 'placement' is SharedArena, data is appended to the VertexArena for this buffer's vertex layout,
+	//  so meshes from every such buffer can be drawn with the same vao (mesh start values are then offsets in the arena).
+	enum DataRetention {
+		UploadOnly,
+		KeepCPUCopy
+	};
+	enum Placement {
+		OwnBuffers,
+		SharedArena
+	};
+	MeshBuffer(std::string const &filename, DataRetention retention = UploadOnly, Placement placement = OwnBuffers);
+
+	//construct an empty buffer (caller fills in vbo, attribs, and meshes):
+	MeshBuffer() = default;
+
+	//per-mesh bounds and statistics, in object space (after dequantization, for quantized files):
+	// (read from the file's optional 'bnd0' chunk, in this layout, or computed at load time if it is absent)
+	struct Bounds {
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+		glm::vec3 center = glm::vec3(0.0f); //bounding sphere (centered on the box)
+		float radius = 0.0f;
+		uint32_t triangle_count = 0;
+		float surface_area = 0.0f;
+	};
+	static_assert(sizeof(Bounds) == 48, "Bounds should be packed");
+
+	//draw a range of vertices as triangles (or, if indexed, of 32-bit indices in the bound vao's element buffer):
+	static void draw_range(bool indexed, GLuint start, GLuint count) {
+		if (indexed) glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (GLbyte *)0 + start * sizeof(GLuint));
+		else glDrawArrays(GL_TRIANGLES, start, count);
+	}
 
 	//look up a particular mesh in the DB:
 	// note: will throw if mesh not found.
 	struct Mesh {
-		GLuint start = 0;
+		GLuint start = 0; //first vertex (or, if indexed, first index)
 		GLuint count = 0;
+		bool indexed = false;
+		//for quantized files, the (normalized) Position attribute maps to position_offset + position_scale * Position:
+		// (copy these to Scene::Object, which applies them in the object's matrix)
+		glm::vec3 position_offset = glm::vec3(0.0f);
+		glm::vec3 position_scale = glm::vec3(1.0f);
+		Bounds bounds;
+
+		//draw the mesh as triangles (with a vao made from its buffer bound):
+		void draw() const {
+			draw_range(indexed, start, count);
+		}
 	};
 	const Mesh &lookup(std::string const &name) const;
+
+	//meshes can also be resolved once, by name, to a 'Handle' (their index in 'meshes'),
+	// then fetched by handle without any searching (e.g., when selecting meshes every frame):
+	typedef uint32_t Handle;
+	Handle find(std::string const &name) const; //returns -1U if not found
+	Handle lookup_handle(std::string const &name) const; //note: will throw if mesh not found
+	const Mesh &lookup(Handle handle) const {
+		assert(handle < meshes.size());
+		return meshes[handle];
+	}
+
+	//look up a mesh and its levels of detail (named 'name_LOD1', 'name_LOD2', ... by export-meshes.py):
+	// returns [name, name_LOD1, ...] up to the first missing level.
+	// note: will throw if 'name' itself is not found.
+	std::vector< Mesh > lookup_lods(std::string const &name) const;
 	
-	//build a vertex array object that links this vbo to attributes to a program:
+	//get a vertex array object that links this vbo to attributes to a program:
 	//  will throw if program defines attributes not contained in this buffer
 	//  and warn if this buffer contains attributes not active in the program
+	//  (vaos are cached by the attribute locations they use -- so programs with the same locations share one --
+	//   in 'vaos', or in the arena's for buffers in an arena; they belong to the cache, so don't delete them)
+	//  (programs' attribute locations are also cached, so programs are assumed to live until exit, as loaded data does)
 	GLuint make_vao_for_program(GLuint program) const;
 
+	//locations of the Position, Normal, Color, and TexCoord attributes a vao binds (-1 where not bound):
+	typedef std::array< GLint, 4 > AttribLocations;
+	mutable std::map< AttribLocations, GLuint > vaos; //made by make_vao_for_program (unless buffer is in an arena)
+
 	//internals:
-	std::map< std::string, Mesh > meshes;
+	std::vector< Mesh > meshes; //in file order (indexed by Handle)
+	std::vector< std::pair< std::string, Handle > > names; //sorted by name, for find()
+
+	//CPU-side copy of vertex data (empty unless constructed with KeepCPUCopy):
+	std::vector< uint8_t > cpu_data;
+	GLuint vertex_count = 0;
+
+	//...and of index data (empty unless file is indexed and constructed with KeepCPUCopy):
+	std::vector< GLuint > cpu_indices;
+	GLuint index_count = 0;
+
+	//(used by the constructor and by MeshLoader) read the contents of a file into this buffer, without any GL calls:
+	// fills in attribs, meshes, names, counts, and (per 'retention') CPU copies; returns the data to upload, which points into 'bytes'.
+	struct FileData {
+		void const *vertices = nullptr; //vertex_count vertices of Position.stride bytes
+		bool indexed = false;
+		GLuint const *indices = nullptr; //index_count indices (if indexed)
+	};
+	FileData read(Span< uint8_t > const &bytes, std::string const &filename, DataRetention retention);
+
+	//for buffers in an arena, where this buffer's data starts in vbo / ebo:
+	// (cpu_data and cpu_indices are not offset; cpu_indices[i - first_index] + first_vertex is the vertex in vbo)
+	VertexArena *arena = nullptr;
+	GLuint first_vertex = 0;
+	GLuint first_index = 0;
 };
@@ -0,0 +1,196 @@
+#include "MeshLoader.hpp"
+#include "AssetPack.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+constexpr uint32_t MeshLoader::DefaultSlotBytes;
+constexpr uint32_t MeshLoader::DefaultSlotCount;
+
+MeshLoader *mesh_loader = nullptr;
+
+MeshLoader::MeshLoader(uint32_t slot_bytes_, uint32_t slot_count) : slot_bytes(slot_bytes_), slots(slot_count) {
+	if (slot_bytes == 0 || slot_count == 0) {
+		throw std::runtime_error("MeshLoader needs at least one non-empty staging buffer.");
+	}
+	for (auto &slot : slots) {
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+		glBufferData(GL_COPY_READ_BUFFER, slot_bytes, NULL, GL_STREAM_COPY);
+		map(slot);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	thread = std::thread(&MeshLoader::run, this);
+}
+
+MeshLoader::~MeshLoader() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	thread.join();
+
+	for (auto &slot : slots) {
+		if (slot.data) {
+			glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+			glUnmapBuffer(GL_COPY_READ_BUFFER);
+			slot.data = nullptr;
+		}
+		if (slot.fence) {
+			glDeleteSync(slot.fence);
+			slot.fence = 0;
+		}
+		glDeleteBuffers(1, &slot.buffer);
+		slot.buffer = 0;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+std::shared_ptr< MeshLoader::Request const > MeshLoader::load(std::string const &filename, MeshBuffer::DataRetention retention) {
+	std::shared_ptr< Request > request = std::make_shared< Request >();
+	request->filename = filename;
+	request->retention = retention;
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		queue.emplace_back(request);
+	}
+	wake.notify_all();
+	return request;
+}
+
+void MeshLoader::update() {
+	std::unique_lock< std::mutex > lock(mutex);
+
+	//copy filled slots into their buffers, in the order they were filled:
+	// (GL_COPY_WRITE_BUFFER is used for the destination so that no vao's element buffer binding is disturbed)
+	while (slots[next_copy].state == Slot::Filled) {
+		Slot &slot = slots[next_copy];
+		MeshBuffer &buffer = slot.request->buffer;
+		GLuint &name = (slot.indices ? buffer.ebo : buffer.vbo);
+		if (name == 0) {
+			GLsizeiptr total = (slot.indices ? GLsizeiptr(buffer.index_count) * sizeof(GLuint) : GLsizeiptr(buffer.vertex_count) * buffer.Position.stride);
+			glGenBuffers(1, &name);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, name);
+			glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STATIC_DRAW);
+		} else {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, name);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		slot.data = nullptr;
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, slot.offset, slot.size);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.state = Slot::Copying;
+		next_copy = (next_copy + 1) % slots.size();
+	}
+
+	//map slots whose copies have finished, so the worker can fill them again:
+	bool freed = false;
+	for (auto &slot : slots) {
+		if (slot.state != Slot::Copying) continue;
+		GLenum status = glClientWaitSync(slot.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+		slot.request = nullptr;
+		map(slot);
+		slot.state = Slot::Free;
+		freed = true;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	//loads whose data is all staged have had their last copies issued above:
+	// (draws issued after this point are ordered after those copies)
+	for (auto r = active.begin(); r != active.end(); ) {
+		if ((*r)->staged) {
+			(*r)->ready = true;
+			r = active.erase(r);
+		} else {
+			++r;
+		}
+	}
+
+	if (freed) wake.notify_all();
+}
+
+bool MeshLoader::idle() {
+	std::unique_lock< std::mutex > lock(mutex);
+	return queue.empty() && active.empty();
+}
+
+void MeshLoader::run() {
+	std::unique_lock< std::mutex > lock(mutex);
+	while (true) {
+		wake.wait(lock, [this](){ return quit || !queue.empty(); });
+		if (quit) break;
+		std::shared_ptr< Request > request = queue.front();
+		queue.pop_front();
+		active.emplace_back(request);
+		lock.unlock();
+
+		bool staged = false;
+		std::exception_ptr load_error;
+		try {
+			DataFile file = open_data_file(request->filename);
+			MeshBuffer &buffer = request->buffer;
+			MeshBuffer::FileData data = buffer.read(file.bytes, request->filename, request->retention);
+			staged = stage(*request, false, reinterpret_cast< uint8_t const * >(data.vertices), size_t(buffer.vertex_count) * buffer.Position.stride);
+			if (staged && data.indexed) {
+				staged = stage(*request, true, reinterpret_cast< uint8_t const * >(data.indices), size_t(buffer.index_count) * sizeof(GLuint));
+			}
+		} catch (...) {
+			load_error = std::current_exception();
+		}
+
+		lock.lock();
+		if (load_error) {
+			//(nothing was staged, since the file is read before staging starts)
+			request->error = load_error;
+			request->failed = true;
+			active.erase(std::find(active.begin(), active.end(), request));
+		} else if (staged) {
+			request->staged = true;
+		} else {
+			break; //(quitting)
+		}
+	}
+}
+
+bool MeshLoader::stage(Request &request, bool indices, uint8_t const *data, size_t size) {
+	for (size_t offset = 0; offset < size; offset += slot_bytes) {
+		Slot *slot;
+		{ //claim the next slot once it is free:
+			std::unique_lock< std::mutex > lock(mutex);
+			wake.wait(lock, [this](){ return quit || slots[next_fill].state == Slot::Free; });
+			if (quit) return false;
+			slot = &slots[next_fill];
+			next_fill = (next_fill + 1) % slots.size();
+		}
+
+		//(update() leaves free slots alone, so this copy needs no lock)
+		size_t count = std::min(size - offset, size_t(slot_bytes));
+		std::memcpy(slot->data, data + offset, count);
+
+		{
+			std::unique_lock< std::mutex > lock(mutex);
+			slot->request = &request;
+			slot->indices = indices;
+			slot->offset = GLintptr(offset);
+			slot->size = GLsizeiptr(count);
+			slot->state = Slot::Filled;
+		}
+	}
+	return true;
+}
+
+void MeshLoader::map(Slot &slot) {
+	glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+	slot.data = glMapBufferRange(GL_COPY_READ_BUFFER, 0, slot_bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!slot.data) {
+		throw std::runtime_error("Failed to map MeshLoader staging buffer.");
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "MeshBuffer.hpp"
+#include "GL.hpp"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+//"MeshLoader" loads MeshBuffers in the background (e.g., for a level that is loaded while playing):
+// a worker thread reads and parses each file (MeshBuffer::read) and copies its vertex and index data
+// into a ring of mapped staging buffers; on the GL thread, update() unmaps filled staging buffers,
+// copies them into the mesh buffers (glCopyBufferSubData), and fences them before they are mapped again.
+//So the GL thread never waits on file I/O, and each frame's upload work is bounded by the ring's size.
+//
+//main() creates 'mesh_loader' and calls its update() at the start of every frame, on the thread that draws
+// (the render thread, if there is one; see RenderThread.hpp), so modes only queue loads and watch for them:
+// //in Mode::update:
+// if (!level) level = mesh_loader->load(data_path("level.pnc"));
+// //(if level->failed is set instead, level->error holds the exception -- e.g., for a missing file)
+// //in Mode::prepare_draw (or draw), once level->ready is set:
+// // use level->buffer only from the drawing code (e.g., call make_vao_for_program in the returned function)
+//
+//(GL 3.3 has no persistent mapping, so each staging buffer is mapped by update() when it is free
+// and stays mapped -- while the worker fills it -- until update() unmaps it to copy from it)
+
+struct MeshLoader {
+	//create (and map) 'slot_count' staging buffers of 'slot_bytes' each and start the worker thread:
+	MeshLoader(uint32_t slot_bytes = DefaultSlotBytes, uint32_t slot_count = DefaultSlotCount);
+	static constexpr uint32_t DefaultSlotBytes = 1 << 20;
+	static constexpr uint32_t DefaultSlotCount = 4;
+	//stops the worker (abandoning unfinished loads) and deletes the staging buffers:
+	~MeshLoader();
+	MeshLoader(MeshLoader const &) = delete;
+
+	struct Request {
+		std::string filename;
+		MeshBuffer::DataRetention retention = MeshBuffer::UploadOnly;
+		MeshBuffer buffer; //usable once 'ready' is set
+		std::atomic< bool > ready{false}; //set by update() after the buffer's last copy is issued
+		std::atomic< bool > failed{false}; //set by the worker if reading the file failed (instead of 'ready')
+		std::exception_ptr error; //why the load failed (valid once 'failed' is set)
+
+		//internals:
+		bool staged = false; //worker has passed all data to staging buffers
+	};
+
+	//queue 'filename' for loading (files are loaded one at a time, in order):
+	// (the buffer gets its own vbo / ebo, as with MeshBuffer::OwnBuffers; arenas aren't supported)
+	// note: may be called from any thread.
+	std::shared_ptr< Request const > load(std::string const &filename, MeshBuffer::DataRetention retention = MeshBuffer::UploadOnly);
+
+	//on the GL thread (e.g., once per frame): copy filled staging buffers, recycle ones whose copies are done, and mark finished loads ready:
+	// note: loads that fail are marked 'failed' instead of throwing; this only throws if a staging buffer can't be mapped.
+	void update();
+
+	//no loads are queued or in progress:
+	bool idle();
+
+	//internals:
+	struct Slot {
+		GLuint buffer = 0;
+		enum State {
+			Free, //mapped (at 'data'), waiting for the worker
+			Filled, //worker has written 'size' bytes, to be copied to 'offset' in 'request's vbo or ebo
+			Copying //copy issued, waiting on 'fence'
+		} state = Free;
+		void *data = nullptr;
+		GLsync fence = 0;
+		Request *request = nullptr;
+		bool indices = false; //copy to request's ebo (otherwise vbo)
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+	};
+	void run(); //worker thread
+	bool stage(Request &request, bool indices, uint8_t const *data, size_t size); //(worker) copy data through the staging ring; false if quitting
+	void map(Slot &slot); //(GL thread)
+
+	uint32_t slot_bytes;
+	std::vector< Slot > slots;
+	uint32_t next_fill = 0; //slot the worker fills next
+	uint32_t next_copy = 0; //slot update() copies next
+
+	std::deque< std::shared_ptr< Request > > queue; //loads waiting for the worker
+	std::vector< std::shared_ptr< Request > > active; //loads the worker has started, but that aren't ready
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake; //signaled when a load is queued, a slot is freed, or the loader is quitting
+	bool quit = false;
+};
+
+//the game's loader, created (and destroyed) by main() while the OpenGL context is current on the main thread:
+extern MeshLoader *mesh_loader;
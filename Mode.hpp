@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 
 #include <memory>
+#include <functional>
 
 class Mode : public std::enable_shared_from_this< Mode > {
 public:
@@ -21,6 +22,12 @@ public:
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
+	//prepare_draw is called (instead of draw) when drawing happens on a separate render thread:
+	// it runs on the same thread as update, and returns a function that issues the frame's OpenGL calls on the render thread
+	// (while the next update runs, so the function must not read state that update changes).
+	//Modes that return nullptr (the default) have draw called on the render thread while the main thread waits.
+	virtual std::function< void() > prepare_draw(glm::uvec2 const &drawable_size) { return nullptr; }
+
 	//Mode::current is the Mode to which events are dispatched.
 	// use 'set_current' to change the current Mode (e.g., to switch to a menu)
 	static std::shared_ptr< Mode > current;
@@ -0,0 +1,165 @@
+#include "OcclusionQueries.hpp"
+
+#include "compile_program.hpp"
+#include "RenderStats.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cassert>
+
+OcclusionQueries::~OcclusionQueries() {
+	for (auto &q : queries) {
+		if (q.name != 0) glDeleteQueries(1, &q.name);
+		q.name = 0;
+	}
+	if (vao != 0) {
+		glDeleteVertexArrays(1, &vao);
+		vao = 0;
+	}
+	if (vbo != 0) {
+		glDeleteBuffers(1, &vbo);
+		vbo = 0;
+	}
+	if (program != 0) {
+		glDeleteProgram(program);
+		program = 0;
+	}
+}
+
+uint32_t OcclusionQueries::acquire() {
+	uint32_t slot;
+	if (!free_slots.empty()) {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	} else {
+		slot = uint32_t(generations.size());
+		generations.emplace_back(0);
+	}
+	generations[slot] += 1; //(so the previous owner's result isn't reported)
+	return slot;
+}
+
+void OcclusionQueries::release(uint32_t slot) {
+	assert(slot < generations.size());
+	free_slots.emplace_back(slot);
+}
+
+OcclusionQueries::Query &OcclusionQueries::query(uint32_t slot, uint32_t generation) {
+	if (slot >= queries.size()) queries.resize(slot + 1);
+	Query &q = queries[slot];
+	if (q.generation != generation) {
+		q.generation = generation;
+		q.pending = false;
+		q.hidden = false;
+	}
+	return q;
+}
+
+bool OcclusionQueries::hidden(uint32_t slot, uint32_t generation) {
+	Query &q = query(slot, generation);
+	if (q.pending) {
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(q.name, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint passed = GL_FALSE;
+			glGetQueryObjectuiv(q.name, GL_QUERY_RESULT, &passed);
+			q.hidden = (passed == GL_FALSE);
+			q.pending = false;
+		}
+	}
+	return q.hidden;
+}
+
+void OcclusionQueries::begin() {
+	if (program == 0) {
+		program = compile_program(
+			"#version 330\n"
+			"uniform mat4 object_to_clip;\n"
+			"layout(location=0) in vec4 Position;\n"
+			"void main() {\n"
+			"	gl_Position = object_to_clip * Position;\n"
+			"}\n"
+			,
+			"#version 330\n"
+			"out vec4 fragColor;\n"
+			"void main() {\n"
+			"	fragColor = vec4(1.0);\n"
+			"}\n"
+		);
+		program_object_to_clip_mat4 = glGetUniformLocation(program, "object_to_clip");
+
+		//unit cube [0,1]^3 as triangles (counter-clockwise from outside):
+		static glm::vec3 const corners[8] = {
+			glm::vec3(0,0,0), glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(1,1,0),
+			glm::vec3(0,0,1), glm::vec3(1,0,1), glm::vec3(0,1,1), glm::vec3(1,1,1),
+		};
+		static uint8_t const faces[6][4] = { //(each face as a quad a,b,c,d -> triangles abc, cbd)
+			{0,2,1,3}, {4,5,6,7}, //-z, +z
+			{0,1,4,5}, {2,6,3,7}, //-y, +y
+			{0,4,2,6}, {1,3,5,7}, //-x, +x
+		};
+		std::vector< glm::vec3 > triangles;
+		for (auto const &f : faces) {
+			triangles.emplace_back(corners[f[0]]);
+			triangles.emplace_back(corners[f[1]]);
+			triangles.emplace_back(corners[f[2]]);
+			triangles.emplace_back(corners[f[2]]);
+			triangles.emplace_back(corners[f[1]]);
+			triangles.emplace_back(corners[f[3]]);
+		}
+
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, triangles.size() * sizeof(glm::vec3), triangles.data(), GL_STATIC_DRAW);
+
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLbyte *)0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	glGetBooleanv(GL_COLOR_WRITEMASK, saved_color_mask);
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &saved_depth_mask);
+	glGetIntegerv(GL_DEPTH_FUNC, &saved_depth_func);
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glDepthFunc(GL_LEQUAL); //(so boxes touching visible surfaces count as visible)
+
+	glUseProgram(program);
+	glBindVertexArray(vao);
+	render_stats.program_switches += 1;
+	render_stats.vao_switches += 1;
+}
+
+void OcclusionQueries::issue(uint32_t slot, uint32_t generation, glm::mat4 const &object_to_clip, glm::vec3 const &min, glm::vec3 const &max) {
+	Query &q = query(slot, generation);
+	if (q.name == 0) glGenQueries(1, &q.name);
+
+	glm::vec3 size = max - min;
+	glm::mat4 box_to_clip = object_to_clip * glm::mat4(
+		glm::vec4(size.x, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, size.y, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, size.z, 0.0f),
+		glm::vec4(min, 1.0f)
+	);
+	glUniformMatrix4fv(program_object_to_clip_mat4, 1, GL_FALSE, glm::value_ptr(box_to_clip));
+
+	glBeginQuery(GL_ANY_SAMPLES_PASSED, q.name);
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+	glEndQuery(GL_ANY_SAMPLES_PASSED);
+	q.pending = true;
+	render_stats.uniform_calls += 1;
+	render_stats.draw_calls += 1;
+	render_stats.triangles += 12;
+}
+
+void OcclusionQueries::end() {
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glColorMask(saved_color_mask[0], saved_color_mask[1], saved_color_mask[2], saved_color_mask[3]);
+	glDepthMask(saved_depth_mask);
+	glDepthFunc(GLenum(saved_depth_func));
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+//"OcclusionQueries" manages GPU occlusion queries against bounding boxes (used by Scene::draw):
+// each frame, a box is drawn (with color/depth writes off) for every tested object after the scene is drawn,
+// and the next frame's draw skips objects whose box had no visible samples.
+//Slots are handed out without any OpenGL calls (so objects can be created/deleted off the GL thread);
+// query objects are created the first time a slot is used.
+//Each acquire() of a slot gets a new generation, which the GL-side functions take along with the slot,
+// so a slot's new owner never sees its old owner's results. The two sides share no data, so
+// acquire/release/generation may run on one thread while hidden/begin/issue/end run on a render thread.
+
+struct OcclusionQueries {
+	OcclusionQueries() = default;
+	OcclusionQueries(OcclusionQueries const &) = delete;
+	~OcclusionQueries();
+
+	//---- slot management (no OpenGL calls) ----
+	//get/return a query slot:
+	uint32_t acquire();
+	void release(uint32_t slot);
+	//generation of a slot (changes every time the slot is acquired):
+	uint32_t generation(uint32_t slot) const {
+		return generations[slot];
+	}
+
+	std::vector< uint32_t > generations; //per slot
+	std::vector< uint32_t > free_slots;
+
+	//---- queries (OpenGL calls) ----
+	//was the box hidden when last tested? (reads the newest available result; false if there isn't one yet)
+	bool hidden(uint32_t slot, uint32_t generation);
+
+	//issue queries: call begin(), then issue() for each box, then end():
+	// (begin/end save and restore the color mask, depth mask, and depth func)
+	void begin();
+	//draw box [min,max] (in object space) with the given object-to-clip matrix:
+	void issue(uint32_t slot, uint32_t generation, glm::mat4 const &object_to_clip, glm::vec3 const &min, glm::vec3 const &max);
+	void end();
+
+	//per-slot query state:
+	struct Query {
+		GLuint name = 0; //query object (0 until first issued)
+		uint32_t generation = 0; //slot generation the state below belongs to
+		bool pending = false; //issued, result not read yet
+		bool hidden = false; //last result read
+	};
+	std::vector< Query > queries;
+	//make sure 'slot' exists in 'queries' and belongs to 'generation':
+	Query &query(uint32_t slot, uint32_t generation);
+
+	//proxy box drawing (created on first begin()):
+	GLuint program = 0;
+	GLuint program_object_to_clip_mat4 = -1U;
+	GLuint vbo = 0;
+	GLuint vao = 0;
+
+	//saved state:
+	GLboolean saved_color_mask[4] = {GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE};
+	GLboolean saved_depth_mask = GL_TRUE;
+	GLint saved_depth_func = GL_LESS;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+//"Pool" allocates objects of one type out of large blocks and keeps destroyed slots for reuse:
+// (so once a pool has grown to fit a workload, creating and destroying objects never touches the heap)
+
+template< typename T >
+struct Pool {
+	Pool() = default;
+	Pool(Pool const &) = delete;
+	~Pool() {
+		assert(live == 0 && "All pooled objects must be destroyed before their pool.");
+		for (auto block : blocks) {
+			delete[] block;
+		}
+	}
+
+	//construct a new object in a free slot:
+	template< typename... Args >
+	T *create(Args&&... args) {
+		reserve(1);
+		T *t = free.back();
+		free.pop_back();
+		new (t) T(std::forward< Args >(args)...);
+		++live;
+		return t;
+	}
+
+	//destroy an object, returning its slot to the pool:
+	void destroy(T *t) {
+		assert(t && live > 0);
+		t->~T();
+		free.emplace_back(t);
+		--live;
+	}
+
+	//make sure at least 'count' slots are free (so the next 'count' creates won't allocate):
+	void reserve(uint32_t count) {
+		if (free.size() >= count) return;
+		uint32_t needed = count - uint32_t(free.size());
+		uint32_t size = (needed > next_block_size ? needed : next_block_size);
+		next_block_size *= 2;
+		Slot *block = new Slot[size];
+		blocks.emplace_back(block);
+		free.reserve(free.size() + size + live);
+		//push in reverse so slots are handed out in address order:
+		for (uint32_t i = size - 1; i < size; --i) {
+			free.emplace_back(reinterpret_cast< T * >(block + i));
+		}
+	}
+
+	typedef typename std::aligned_storage< sizeof(T), alignof(T) >::type Slot;
+	std::vector< Slot * > blocks;
+	std::vector< T * > free; //slots available for create() (last is used first)
+	uint32_t live = 0; //number of objects currently created
+	uint32_t next_block_size = 64;
+};
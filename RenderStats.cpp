@@ -0,0 +1,67 @@
+#include "RenderStats.hpp"
+
+RenderStats render_stats;
+
+namespace {
+	RenderStats history[RenderStatsHistory];
+	float history_ms[RenderStatsHistory];
+	uint32_t history_next = 0; //slot for the next finished frame
+	uint32_t history_count = 0; //slots filled so far
+}
+
+void render_stats_end_frame(float elapsed) {
+	history[history_next] = render_stats;
+	history_ms[history_next] = elapsed * 1000.0f;
+	history_next = (history_next + 1) % RenderStatsHistory;
+	if (history_count < RenderStatsHistory) ++history_count;
+	render_stats = RenderStats();
+}
+
+RenderStats const &render_stats_last() {
+	static RenderStats const empty;
+	if (history_count == 0) return empty;
+	return history[(history_next + RenderStatsHistory - 1) % RenderStatsHistory];
+}
+
+RenderStats render_stats_average() {
+	RenderStats ret;
+	if (history_count == 0) return ret;
+	//(sums in 64 bits, since per-frame counts can be large)
+	uint64_t sums[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	for (uint32_t i = 0; i < history_count; ++i) {
+		RenderStats const &s = history[i];
+		sums[0] += s.draw_calls;
+		sums[1] += s.triangles;
+		sums[2] += s.program_switches;
+		sums[3] += s.vao_switches;
+		sums[4] += s.uniform_calls;
+		sums[5] += s.block_binds;
+		sums[6] += s.buffer_uploads;
+		sums[7] += s.upload_bytes;
+		sums[8] += s.samples_shaded;
+		sums[9] += s.sampled_pixels;
+	}
+	auto avg = [&](uint64_t sum) {
+		return uint32_t((sum + history_count / 2) / history_count);
+	};
+	ret.draw_calls = avg(sums[0]);
+	ret.triangles = avg(sums[1]);
+	ret.program_switches = avg(sums[2]);
+	ret.vao_switches = avg(sums[3]);
+	ret.uniform_calls = avg(sums[4]);
+	ret.block_binds = avg(sums[5]);
+	ret.buffer_uploads = avg(sums[6]);
+	ret.upload_bytes = avg(sums[7]);
+	ret.samples_shaded = avg(sums[8]);
+	ret.sampled_pixels = avg(sums[9]);
+	return ret;
+}
+
+float render_stats_average_ms() {
+	if (history_count == 0) return 0.0f;
+	float sum = 0.0f;
+	for (uint32_t i = 0; i < history_count; ++i) {
+		sum += history_ms[i];
+	}
+	return sum / float(history_count);
+}
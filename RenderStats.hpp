@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+//"RenderStats" counts the OpenGL work done to draw a frame:
+// Scene::draw, draw_text, and OcclusionQueries add to 'render_stats' as they issue calls;
+// the main loop calls render_stats_end_frame() once per frame to move the counts into a rolling history.
+
+struct RenderStats {
+	uint32_t draw_calls = 0;
+	uint32_t triangles = 0;
+	uint32_t program_switches = 0; //glUseProgram calls
+	uint32_t vao_switches = 0; //glBindVertexArray calls
+	uint32_t uniform_calls = 0; //glUniform* calls
+	uint32_t block_binds = 0; //uniform block (re-)bindings, e.g. one per object using the 'Object' block
+	uint32_t buffer_uploads = 0; //buffer data uploads (uniform blocks, mesh data, ...)
+	uint32_t upload_bytes = 0;
+	//samples passing the depth test in Scene's main pass (only if Scene::count_samples is set):
+	// (added by the frame that reads a query result, along with the pixel count of the draw it measured)
+	uint32_t samples_shaded = 0;
+	uint32_t sampled_pixels = 0;
+};
+
+//counts for the frame being drawn:
+extern RenderStats render_stats;
+
+//finish a frame that took 'elapsed' seconds: records render_stats in the history and resets it:
+void render_stats_end_frame(float elapsed);
+
+//counts for the last finished frame:
+RenderStats const &render_stats_last();
+
+//averages over the last (up to) RenderStatsHistory finished frames:
+constexpr uint32_t RenderStatsHistory = 60;
+RenderStats render_stats_average(); //(rounded to nearest)
+float render_stats_average_ms(); //frame time, in milliseconds
@@ -0,0 +1,86 @@
+#include "RenderThread.hpp"
+
+#include <stdexcept>
+#include <string>
+
+RenderThread::RenderThread(SDL_Window *window_, SDL_GLContext context_) : window(window_), context(context_) {
+	SDL_GL_MakeCurrent(window, nullptr);
+
+	busy = true; //(until the context is current on the render thread)
+	thread = std::thread([this](){
+		std::unique_lock< std::mutex > lock(mutex);
+		if (SDL_GL_MakeCurrent(window, context) != 0) {
+			error = std::make_exception_ptr(std::runtime_error("Failed to make OpenGL context current on render thread (" + std::string(SDL_GetError()) + ")."));
+			busy = false;
+			idle.notify_all();
+			return;
+		}
+		busy = false;
+		idle.notify_all();
+
+		while (true) {
+			wake.wait(lock, [this](){ return quit || busy; });
+			if (!busy) break; //(quit with no frame pending)
+			std::function< void() > run;
+			std::swap(run, frame);
+			lock.unlock();
+			std::exception_ptr run_error;
+			try {
+				run();
+			} catch (...) {
+				run_error = std::current_exception();
+			}
+			run = nullptr; //(release the frame's captured state here, while the context is current)
+			lock.lock();
+			if (run_error) error = run_error;
+			busy = false;
+			idle.notify_all();
+		}
+
+		SDL_GL_MakeCurrent(window, nullptr);
+	});
+
+	try {
+		finish();
+	} catch (...) {
+		thread.join();
+		SDL_GL_MakeCurrent(window, context);
+		throw;
+	}
+}
+
+RenderThread::~RenderThread() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		idle.wait(lock, [this](){ return !busy; });
+		quit = true;
+	}
+	wake.notify_all();
+	thread.join();
+	SDL_GL_MakeCurrent(window, context);
+}
+
+void RenderThread::submit(std::function< void() > frame_) {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		idle.wait(lock, [this](){ return !busy; });
+		if (error) {
+			std::exception_ptr rethrow = error;
+			error = nullptr;
+			std::rethrow_exception(rethrow);
+		}
+		frame = std::move(frame_);
+		busy = true;
+	}
+	wake.notify_all();
+}
+
+void RenderThread::finish() {
+	std::unique_lock< std::mutex > lock(mutex);
+	idle.wait(lock, [this](){ return !busy; });
+	if (error) {
+		std::exception_ptr rethrow = error;
+		error = nullptr;
+		std::rethrow_exception(rethrow);
+	}
+}
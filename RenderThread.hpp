@@ -0,0 +1,44 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+//"RenderThread" owns the OpenGL context and runs one frame's worth of GL calls at a time,
+// so that the main thread can handle events and update the next frame while the current one is drawn.
+//Frames are usually closures over a snapshot (see Scene::prepare_draw / Scene::submit_draw);
+// at most one frame is in flight, so two snapshots are enough to never share one between threads.
+
+struct RenderThread {
+	//makes 'context' current on a new render thread (and not current on the calling thread):
+	// note: will throw if the context can't be made current on the render thread.
+	RenderThread(SDL_Window *window, SDL_GLContext context);
+	//finishes the last frame and makes 'context' current on the calling thread again:
+	~RenderThread();
+	RenderThread(RenderThread const &) = delete;
+
+	//wait for the previous frame to finish, then start running 'frame' on the render thread:
+	// (the frame's captured state is released on the render thread, so it may own GL objects)
+	// note: rethrows any exception thrown by the previous frame.
+	void submit(std::function< void() > frame);
+
+	//wait for the last submitted frame to finish:
+	// note: rethrows any exception thrown by that frame.
+	void finish();
+
+	//internals:
+	SDL_Window *window;
+	SDL_GLContext context;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake; //signaled when a frame is submitted (or thread is quitting)
+	std::condition_variable idle; //signaled when a frame is finished
+	std::function< void() > frame; //frame to run next
+	bool busy = false; //a frame is submitted but not finished
+	bool quit = false;
+	std::exception_ptr error; //exception thrown by the last frame (rethrown by submit / finish)
+};
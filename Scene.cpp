@@ -1,9 +1,19 @@
 #include "Scene.hpp"
 
+#include "AssetPack.hpp"
+#include "MeshBuffer.hpp"
+#include "WorkerPool.hpp"
+#include "SpatialIndex.hpp"
+#include "RenderStats.hpp"
+#include "compile_program.hpp"
+
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
 
 glm::mat4 Scene::Transform::make_local_to_parent() const {
 	return glm::mat4( //translate
@@ -75,6 +85,7 @@ void Scene::Transform::DEBUG_assert_valid_pointers() const {
 
 void Scene::Transform::set_parent(Transform *new_parent, Transform *before) {
 	DEBUG_assert_valid_pointers();
+	if (hierarchy_version) ++*hierarchy_version;
 	assert(before == nullptr || (new_parent != nullptr && before->parent == new_parent));
 	if (parent) {
 		//remove from existing parent:
@@ -107,21 +118,62 @@ glm::mat4 Scene::Camera::make_projection() const {
 
 //---------------------------
 
+void Scene::Material::set_parameter(GLuint location, GLuint components, glm::vec4 const &value) {
+	assert(components >= 1 && components <= 4);
+	Parameter *slot = nullptr;
+	for (auto &p : parameters) {
+		if (p.location == location) {
+			slot = &p;
+			break;
+		}
+		if (!slot && p.location == -1U) slot = &p;
+	}
+	if (!slot) {
+		throw std::runtime_error("Material has no free parameter slots.");
+	}
+	slot->location = location;
+	slot->components = components;
+	slot->value = value;
+}
+
+void Scene::Material::set_parameter(GLuint location, float value) {
+	set_parameter(location, 1, glm::vec4(value, 0.0f, 0.0f, 0.0f));
+}
+
+void Scene::Material::set_parameter(GLuint location, glm::vec2 const &value) {
+	set_parameter(location, 2, glm::vec4(value.x, value.y, 0.0f, 0.0f));
+}
+
+void Scene::Material::set_parameter(GLuint location, glm::vec3 const &value) {
+	set_parameter(location, 3, glm::vec4(value, 0.0f));
+}
+
+void Scene::Material::set_parameter(GLuint location, glm::vec4 const &value) {
+	set_parameter(location, 4, value);
+}
+
+//---------------------------
+
 //templated helper functions to avoid having to write the same new/delete code three times:
-template< typename T, typename... Args >
-T *list_new(T * &first, Args&&... args) {
-	T *t = new T(std::forward< Args >(args)...); //"perfect forwarding"
+template< typename T >
+void list_link(T * &first, T *t) {
 	if (first) {
 		t->alloc_next = first;
 		first->alloc_prev_next = &t->alloc_next;
 	}
 	t->alloc_prev_next = &first;
 	first = t;
+}
+
+template< typename T, typename... Args >
+T *list_new(T * &first, Pool< T > &pool, Args&&... args) {
+	T *t = pool.create(std::forward< Args >(args)...); //"perfect forwarding"
+	list_link(first, t);
 	return t;
 }
 
 template< typename T >
-void list_delete(T * t) {
+void list_delete(Pool< T > &pool, T * t) {
 	assert(t && "It is invalid to delete a null scene object [yes this is different than 'delete']");
 	assert(t->alloc_prev_next);
 	if (t->alloc_next) {
@@ -131,75 +183,840 @@ void list_delete(T * t) {
 	//PARANOIA:
 	t->alloc_next = nullptr;
 	t->alloc_prev_next = nullptr;
+	pool.destroy(t);
+}
+
+uint32_t Scene::new_material(Scene::Material const &material) {
+	materials.emplace_back(material);
+	return uint32_t(materials.size() - 1);
 }
 
 Scene::Transform *Scene::new_transform() {
-	return list_new< Scene::Transform >(first_transform);
+	++hierarchy_version;
+	Transform *transform = list_new< Scene::Transform >(first_transform, transform_pool);
+	transform->hierarchy_version = &hierarchy_version;
+	transform->handle_index = transform_handles.add(transform).index;
+	return transform;
+}
+
+void Scene::new_transforms(uint32_t count, std::vector< Scene::Transform * > *out) {
+	assert(out);
+	transform_pool.reserve(count);
+	out->reserve(out->size() + count);
+	for (uint32_t i = 0; i < count; ++i) {
+		out->emplace_back(new_transform());
+	}
 }
 
 void Scene::delete_transform(Scene::Transform *transform) {
-	list_delete< Scene::Transform >(transform);
+	++hierarchy_version;
+	transform_handles.remove(transform->handle_index);
+	list_delete< Scene::Transform >(transform_pool, transform);
 }
 
 Scene::Object *Scene::new_object(Scene::Transform *transform) {
 	assert(transform && "Scene::Object must be attached to a transform.");
-	return list_new< Scene::Object >(first_object, transform);
+	Object *object = list_new< Scene::Object >(first_object, object_pool, transform);
+	object->handle_index = object_handles.add(object).index;
+	return object;
+}
+
+void Scene::new_objects(std::vector< Scene::Transform * > const &transforms, std::vector< Scene::Object * > *out) {
+	assert(out);
+	object_pool.reserve(uint32_t(transforms.size()));
+	out->reserve(out->size() + transforms.size());
+	for (auto transform : transforms) {
+		out->emplace_back(new_object(transform));
+	}
 }
 
 void Scene::delete_object(Scene::Object *object) {
-	list_delete< Scene::Object >(object);
+	if (spatial_index) spatial_index->remove(object);
+	if (object->occlusion_slot != -1U) occlusion_queries.release(object->occlusion_slot);
+	remove_from_command_list(object);
+	object_handles.remove(object->handle_index);
+	list_delete< Scene::Object >(object_pool, object);
 }
 
 Scene::Camera *Scene::new_camera(Scene::Transform *transform) {
 	assert(transform && "Scene::Camera must be attached to a transform.");
-	return list_new< Scene::Camera >(first_camera, transform);
+	Camera *camera = list_new< Scene::Camera >(first_camera, camera_pool, transform);
+	camera->handle_index = camera_handles.add(camera).index;
+	return camera;
 }
 
 void Scene::delete_camera(Scene::Camera *object) {
-	list_delete< Scene::Camera >(object);
+	camera_handles.remove(object->handle_index);
+	list_delete< Scene::Camera >(camera_pool, object);
+}
+
+Scene::Lamp *Scene::new_lamp(Scene::Transform *transform) {
+	assert(transform && "Scene::Lamp must be attached to a transform.");
+	return list_new< Scene::Lamp >(first_lamp, lamp_pool, transform);
+}
+
+void Scene::delete_lamp(Scene::Lamp *lamp) {
+	list_delete< Scene::Lamp >(lamp_pool, lamp);
+}
+
+void Scene::load(std::string const &filename,
+	std::function< void(Scene &, Transform *, std::string const &) > const &on_mesh) {
+
+	DataFile file = open_data_file(filename);
+	ChunkReader chunks(file.bytes);
+
+	std::vector< char > strings;
+	chunks.read_chunk("str0", &strings);
+
+	auto get_string = [&strings](uint32_t begin, uint32_t end) {
+		if (!(begin <= end && end <= strings.size())) {
+			throw std::runtime_error("scene entry has out-of-range name begin/end");
+		}
+		return std::string(strings.data() + begin, strings.data() + end);
+	};
+
+	struct HierarchyEntry {
+		int32_t parent;
+		uint32_t name_begin, name_end;
+		glm::vec3 position;
+		glm::vec4 rotation; //(x,y,z,w)
+		glm::vec3 scale;
+	};
+	static_assert(sizeof(HierarchyEntry) == 4 + 4*2 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
+	std::vector< HierarchyEntry > hierarchy;
+	chunks.read_chunk("xfh0", &hierarchy);
+
+	struct MeshEntry {
+		int32_t transform;
+		uint32_t name_begin, name_end;
+	};
+	static_assert(sizeof(MeshEntry) == 4 + 4*2, "MeshEntry is packed.");
+	std::vector< MeshEntry > meshes;
+	chunks.read_chunk("msh0", &meshes);
+
+	struct CameraEntry {
+		int32_t transform;
+		char type[4]; //"pers" or "orth"
+		float data; //fov in degrees for 'pers', scale for 'orth'
+		float clip_near, clip_far;
+	};
+	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
+	std::vector< CameraEntry > cameras;
+	chunks.read_chunk("cam0", &cameras);
+
+	struct LampEntry {
+		int32_t transform;
+		char type; //'p'oint, 'h'emi, 's'pot, 'd'irectional
+		glm::u8vec3 color;
+		float energy;
+		float distance;
+		float fov; //spot lamps only (degrees)
+	};
+	static_assert(sizeof(LampEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LampEntry is packed.");
+	std::vector< LampEntry > lamps;
+	chunks.read_chunk("lmp0", &lamps);
+
+	if (!chunks.at_end()) {
+		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
+	}
+
+	//allocate all transforms at once, then fill in (parents always precede children in the file):
+	std::vector< Transform * > transforms;
+	new_transforms(uint32_t(hierarchy.size()), &transforms);
+	for (uint32_t i = 0; i < hierarchy.size(); ++i) {
+		HierarchyEntry const &h = hierarchy[i];
+		Transform *t = transforms[i];
+		t->name = get_string(h.name_begin, h.name_end);
+		t->position = h.position;
+		t->rotation = glm::quat(h.rotation.w, h.rotation.x, h.rotation.y, h.rotation.z);
+		t->scale = h.scale;
+		if (h.parent != -1) {
+			if (!(h.parent >= 0 && uint32_t(h.parent) < i)) {
+				throw std::runtime_error("scene transform '" + t->name + "' has invalid parent index");
+			}
+			t->set_parent(transforms[h.parent]);
+		}
+	}
+
+	auto get_transform = [&transforms](int32_t index) {
+		if (!(index >= 0 && uint32_t(index) < transforms.size())) {
+			throw std::runtime_error("scene entry has out-of-range transform index");
+		}
+		return transforms[index];
+	};
+
+	for (auto const &m : meshes) {
+		Transform *t = get_transform(m.transform);
+		if (on_mesh) on_mesh(*this, t, get_string(m.name_begin, m.name_end));
+	}
+
+	for (auto const &c : cameras) {
+		Camera *camera = new_camera(get_transform(c.transform));
+		if (std::string(c.type, 4) == "pers") {
+			camera->fovy = glm::radians(c.data);
+		} else {
+			std::cerr << "WARNING: camera '" << camera->transform->name << "' in '" << filename << "' has unsupported type '" << std::string(c.type, 4) << "'; using default perspective." << std::endl;
+		}
+		camera->near = c.clip_near;
+	}
+
+	for (auto const &l : lamps) {
+		Lamp *lamp = new_lamp(get_transform(l.transform));
+		if (l.type == 'p' || l.type == 'h' || l.type == 's' || l.type == 'd') {
+			lamp->type = Lamp::Type(l.type);
+		} else {
+			std::cerr << "WARNING: lamp '" << lamp->transform->name << "' in '" << filename << "' has unknown type '" << l.type << "'; using point." << std::endl;
+		}
+		lamp->color = glm::vec3(l.color) / 255.0f;
+		lamp->energy = l.energy;
+		lamp->distance = l.distance;
+		lamp->spot_fov = glm::radians(l.fov);
+	}
+}
+
+uint32_t Scene::new_command_list() {
+	command_lists.emplace_back();
+	return uint32_t(command_lists.size() - 1);
+}
+
+void Scene::remove_from_command_list(Scene::Object *object) {
+	if (object->command_list == -1U) return;
+	CommandList &list = command_lists[object->command_list];
+	uint32_t i = object->command_index;
+	assert(i < list.commands.size() && list.commands[i].object == object);
+	//swap-remove (order is restored when the list is re-recorded):
+	list.commands[i] = list.commands.back();
+	list.commands[i].object->command_index = i;
+	list.commands.pop_back();
+	if (i < list.uniforms.size()) {
+		list.uniforms[i] = list.uniforms.back();
+		list.uniforms.pop_back();
+	}
+	list.dirty = true;
+	object->command_list = -1U;
+	object->command_index = -1U;
+}
+
+void Scene::record_commands(uint32_t list_index, std::vector< Scene::Object * > const &objects) {
+	assert(list_index < command_lists.size());
+	CommandList &list = command_lists[list_index];
+	while (!list.commands.empty()) {
+		remove_from_command_list(list.commands.back().object);
+	}
+	for (auto object : objects) {
+		assert(object);
+		if (object->material == -1U || !materials[object->material].object_block) continue;
+		if (object->lod_count > 1) continue;
+		remove_from_command_list(object);
+		CommandList::Command command;
+		command.object = object;
+		object->command_list = list_index;
+		object->command_index = uint32_t(list.commands.size());
+		list.commands.emplace_back(command);
+	}
+	list.dirty = true;
+}
+
+void Scene::invalidate_command_list(uint32_t list_index) {
+	if (list_index == -1U) return;
+	assert(list_index < command_lists.size());
+	command_lists[list_index].dirty = true;
+}
+
+//range of vertices (or indices) to draw for an object that doesn't switch LODs:
+static void fixed_draw_range(Scene::Object const *object, GLuint *start, GLuint *count) {
+	if (object->lod_count > 0) {
+		*start = object->lods[0].start;
+		*count = object->lods[0].count;
+	} else {
+		*start = object->start;
+		*count = object->count;
+	}
+}
+
+//matrix taking an object's Position attribute to world space (local_to_world, plus dequantization for quantized meshes):
+static glm::mat4 position_to_world(Scene::Object const *object, glm::mat4 const &local_to_world) {
+	if (object->position_offset == glm::vec3(0.0f) && object->position_scale == glm::vec3(1.0f)) return local_to_world;
+	return local_to_world * glm::mat4(
+		glm::vec4(object->position_scale.x, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, object->position_scale.y, 0.0f, 0.0f),
+		glm::vec4(0.0f, 0.0f, object->position_scale.z, 0.0f),
+		glm::vec4(object->position_offset, 1.0f)
+	);
+}
+
+void Scene::update_command_lists() {
+	for (uint32_t l = 0; l < command_lists.size(); ++l) {
+		CommandList &list = command_lists[l];
+
+		//after hierarchy changes, look for recorded matrices that moved:
+		// (other changes are flagged by invalidate_command_list, so unchanged lists cost nothing here)
+		if (!list.dirty && list.checked_version != hierarchy_version) {
+			for (uint32_t c = 0; c < list.commands.size() && !list.dirty; ++c) {
+				Object const *object = list.commands[c].object;
+				glm::mat4 object_to_light = position_to_world(object, world_matrix(object->transform));
+				if (std::memcmp(&object_to_light, &list.uniforms[c].object_to_light, sizeof(glm::mat4)) != 0) {
+					list.dirty = true;
+				}
+			}
+		}
+		list.checked_version = hierarchy_version;
+		if (!list.dirty) continue;
+
+		//re-record:
+		for (auto &command : list.commands) {
+			command.material = command.object->material;
+			command.vao = command.object->vao;
+			command.indexed = command.object->indexed;
+			fixed_draw_range(command.object, &command.start, &command.count);
+		}
+		std::sort(list.commands.begin(), list.commands.end(), [](CommandList::Command const &a, CommandList::Command const &b) {
+			if (a.material != b.material) return a.material < b.material;
+			return a.vao < b.vao;
+		});
+		list.uniforms.resize(list.commands.size());
+		for (uint32_t c = 0; c < list.commands.size(); ++c) {
+			Object *object = list.commands[c].object;
+			object->command_index = c;
+			glm::mat4 const &local_to_world = world_matrix(object->transform);
+			list.uniforms[c].object_to_light = position_to_world(object, local_to_world);
+			list.uniforms[c].normal_to_light = glm::mat3x4(glm::inverse(glm::transpose(glm::mat3(local_to_world))));
+		}
+		list.dirty = false;
+		list.needs_upload = true;
+	}
+}
+
+void Scene::update_world_matrices() {
+	if (flat_version != hierarchy_version) {
+		//rebuild order: each root, then (breadth-first) its descendants:
+		flat_transforms.clear();
+		flat_parents.clear();
+		for (Transform *root = first_transform; root != nullptr; root = root->alloc_next) {
+			if (root->parent) continue;
+			uint32_t begin = uint32_t(flat_transforms.size());
+			root->flat_index = begin;
+			flat_transforms.emplace_back(root);
+			flat_parents.emplace_back(-1U);
+			for (uint32_t i = begin; i < flat_transforms.size(); ++i) {
+				Transform *t = flat_transforms[i];
+				for (Transform *child = t->last_child; child != nullptr; child = child->prev_sibling) {
+					child->flat_index = uint32_t(flat_transforms.size());
+					flat_transforms.emplace_back(child);
+					flat_parents.emplace_back(i);
+				}
+			}
+		}
+		world_matrices.resize(flat_transforms.size());
+		flat_version = hierarchy_version;
+	}
+
+	//one pass, parents first:
+	for (uint32_t i = 0; i < flat_transforms.size(); ++i) {
+		if (flat_parents[i] == -1U) {
+			world_matrices[i] = flat_transforms[i]->make_local_to_parent();
+		} else {
+			world_matrices[i] = world_matrices[flat_parents[i]] * flat_transforms[i]->make_local_to_parent();
+		}
+	}
 }
 
 void Scene::draw(Scene::Camera const *camera) {
+	DrawSnapshot &snapshot = prepare_draw(camera);
+	submit_draw(snapshot);
+	drawn_count = snapshot.drawn_count;
+	culled_count = snapshot.culled_count;
+	sample_count = snapshot.sample_count;
+}
+
+static Scene::DrawKey draw_key(uint32_t material, GLuint vao, bool by_depth, float depth) {
+	Scene::DrawKey key;
+	key.state = (uint64_t(material) << 32) | uint64_t(vao);
+	key.depth = 0;
+	if (by_depth) {
+		//non-negative floats sort the same as their bit patterns:
+		depth = std::max(0.0f, depth);
+		std::memcpy(&key.depth, &depth, sizeof(key.depth));
+	}
+	return key;
+}
+
+Scene::DrawSnapshot &Scene::prepare_draw(Scene::Camera const *camera) {
 	assert(camera && "Must have a camera to draw scene from.");
 
+	//switch snapshots, collecting the results of the draw that used this one:
+	snapshot_index = (snapshot_index + 1) % 2;
+	DrawSnapshot &snapshot = snapshots[snapshot_index];
+	drawn_count = snapshot.drawn_count;
+	culled_count = snapshot.culled_count;
+	sample_count = snapshot.sample_count;
+
 	glm::mat4 world_to_camera = camera->transform->make_world_to_local();
 	glm::mat4 world_to_clip = camera->make_projection() * world_to_camera;
+	frame_uniforms.world_to_clip = world_to_clip;
+
+	update_world_matrices();
+	camera_position = glm::vec3(world_matrix(camera->transform)[3]);
+
+	snapshot.frame_uniforms = frame_uniforms;
+	snapshot.camera_position = camera_position;
+	snapshot.occlusion_culling = occlusion_culling;
+	snapshot.sort_front_to_back = sort_front_to_back;
+	snapshot.depth_prepass = depth_prepass;
+	snapshot.count_samples = count_samples;
+
+	update_command_lists();
 
+	//view depth of the center of an object's bounds (or its origin):
+	glm::vec4 camera_forward = glm::vec4(0.0f); //(row of world_to_camera giving -depth)
+	for (uint32_t i = 0; i < 4; ++i) camera_forward[i] = world_to_camera[i][2];
+	auto view_depth = [&camera_forward](Scene::Object const *object, glm::mat4 const &local_to_world) {
+		glm::vec4 center = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		if (object->has_bounds) center = glm::vec4(0.5f * (object->bounds_min + object->bounds_max), 1.0f);
+		return -glm::dot(camera_forward, local_to_world * center);
+	};
+
+	//command lists are recorded in (material, vao) order; with sort_front_to_back, each draw re-orders by depth within that:
+	snapshot.list_upload_count = 0;
+	uint32_t list_item_count = 0;
+	for (uint32_t l = 0; l < command_lists.size(); ++l) {
+		CommandList &list = command_lists[l];
+		list.order.resize(list.commands.size());
+		for (uint32_t c = 0; c < list.commands.size(); ++c) {
+			CommandList::Command const &command = list.commands[c];
+			float depth = (sort_front_to_back ? view_depth(command.object, world_matrix(command.object->transform)) : 0.0f);
+			list.order[c] = std::make_pair(draw_key(command.material, command.vao, sort_front_to_back, depth), c);
+		}
+		if (sort_front_to_back) std::sort(list.order.begin(), list.order.end());
+		list_item_count += uint32_t(list.commands.size());
+
+		if (list.needs_upload) {
+			if (snapshot.list_upload_count == snapshot.list_uploads.size()) snapshot.list_uploads.emplace_back();
+			DrawSnapshot::ListUpload &upload = snapshot.list_uploads[snapshot.list_upload_count++];
+			upload.list = l;
+			upload.uniforms = list.uniforms;
+			list.needs_upload = false;
+		}
+	}
+
+	draw_list.clear();
 	for (Scene::Object *object = first_object; object != nullptr; object = object->alloc_next) {
-		glm::mat4 local_to_world = object->transform->make_local_to_world();
+		assert(object->material == -1U || object->material < materials.size());
+		if (object->command_list != -1U) continue; //(drawn from command list)
+		float depth = (sort_front_to_back ? view_depth(object, world_matrix(object->transform)) : 0.0f);
+		draw_list.emplace_back(draw_key(object->material, object->vao, sort_front_to_back, depth), object);
+	}
+	std::sort(draw_list.begin(), draw_list.end(), [](std::pair< DrawKey, Object * > const &a, std::pair< DrawKey, Object * > const &b) {
+		return a.first < b.first;
+	});
+
+	snapshot.items.resize(list_item_count + draw_list.size());
+	snapshot.list_item_count = list_item_count;
+
+	//occlusion culling state for an item (slots are handed out here, without any OpenGL calls):
+	auto set_occlusion = [this](Scene::Object *object, DrawItem &item) {
+		item.hidden = false;
+		if (!occlusion_culling || !object->has_bounds) {
+			item.occlusion_slot = -1U;
+			return;
+		}
+		if (object->occlusion_slot == -1U) object->occlusion_slot = occlusion_queries.acquire();
+		item.occlusion_slot = object->occlusion_slot;
+		item.occlusion_generation = occlusion_queries.generation(object->occlusion_slot);
+		//(boxes are drawn with the same matrix as the object, so bounds are moved into its Position attribute's space)
+		item.bounds_min = (object->bounds_min - object->position_offset) / object->position_scale;
+		item.bounds_max = (object->bounds_max - object->position_offset) / object->position_scale;
+	};
+
+	{ //command-list items:
+		uint32_t i = 0;
+		for (uint32_t l = 0; l < command_lists.size(); ++l) {
+			CommandList const &list = command_lists[l];
+			for (auto const &o : list.order) {
+				CommandList::Command const &command = list.commands[o.second];
+				DrawItem &item = snapshot.items[i++];
+				item.uniforms = list.uniforms[o.second];
+				item.material = command.material;
+				item.vao = command.vao;
+				item.start = command.start;
+				item.count = command.count;
+				item.indexed = command.indexed;
+				item.object_block = true;
+				item.command_list = l;
+				item.command_index = o.second;
+				item.legacy = -1U;
+				set_occlusion(command.object, item);
+			}
+		}
+		assert(i == list_item_count);
+	}
+
+	//objects without a material keep their program info in the snapshot:
+	uint32_t legacy_count = 0;
+	for (uint32_t i = 0; i < draw_list.size(); ++i) {
+		Scene::Object *object = draw_list[i].second;
+		DrawItem &item = snapshot.items[list_item_count + i];
+		item.material = object->material;
+		item.vao = object->vao;
+		item.indexed = object->indexed;
+		item.command_list = -1U;
+		item.command_index = -1U;
+		item.legacy = -1U;
+		if (object->material != -1U) {
+			item.object_block = materials[object->material].object_block;
+		} else {
+			item.object_block = object->object_block;
+			if (legacy_count == snapshot.legacy.size()) snapshot.legacy.emplace_back();
+			DrawSnapshot::Legacy &legacy = snapshot.legacy[legacy_count];
+			legacy.program = object->program;
+			legacy.program_mvp_mat4 = object->program_mvp_mat4;
+			legacy.program_mv_mat4x3 = object->program_mv_mat4x3;
+			legacy.program_itmv_mat3 = object->program_itmv_mat3;
+			legacy.set_uniforms = object->set_uniforms;
+			item.legacy = legacy_count++;
+		}
+		set_occlusion(object, item);
+	}
+
+	//compute matrices and pick LODs; each range only reads transforms and writes its own entries,
+	// so ranges can be computed in parallel:
+	auto compute = [this, &world_to_clip, &snapshot, list_item_count](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Scene::Object *object = draw_list[i].second;
+			glm::mat4 const &local_to_world = world_matrix(object->transform);
+			DrawItem &item = snapshot.items[list_item_count + i];
+			item.uniforms.object_to_light = position_to_world(object, local_to_world);
+			//NOTE: inverse cancels out transpose unless there is scale involved
+			item.uniforms.normal_to_light = glm::mat3x4(glm::inverse(glm::transpose(glm::mat3(local_to_world))));
+			item.object_to_clip = world_to_clip * item.uniforms.object_to_light;
+
+			//pick level of detail, moving at most as far as the distance (plus hysteresis) says to:
+			if (object->lod_count > 1) {
+				float distance = glm::length(glm::vec3(local_to_world[3]) - camera_position);
+				uint32_t lod = std::min(object->lod, object->lod_count - 1);
+				while (lod + 1 < object->lod_count && distance > object->lods[lod + 1].distance * (1.0f + lod_hysteresis)) ++lod;
+				while (lod > 0 && distance < object->lods[lod].distance * (1.0f - lod_hysteresis)) --lod;
+				object->lod = lod;
+			} else {
+				object->lod = 0;
+			}
+			if (object->lod_count > 0) {
+				item.start = object->lods[object->lod].start;
+				item.count = object->lods[object->lod].count;
+			} else {
+				item.start = object->start;
+				item.count = object->count;
+			}
+		}
+	};
+	if (worker_pool) {
+		worker_pool->parallel_for(uint32_t(draw_list.size()), 256, compute);
+	} else {
+		compute(0, uint32_t(draw_list.size()));
+	}
+
+	return snapshot;
+}
+
+void Scene::submit_draw(Scene::DrawSnapshot &snapshot) {
+	std::vector< DrawItem > &items = snapshot.items;
+
+	//per-frame data is uploaded once and shared by all objects:
+	frame_block.set(&snapshot.frame_uniforms, sizeof(FrameUniforms), FrameBinding);
+	render_stats.buffer_uploads += 1;
+	render_stats.upload_bytes += sizeof(FrameUniforms);
 
-		//compute modelview+projection (object space to clip space) matrix for this object:
-		glm::mat4 mvp = world_to_clip * local_to_world;
+	//command lists that were re-recorded get their matrices uploaded:
+	for (uint32_t u = 0; u < snapshot.list_upload_count; ++u) {
+		DrawSnapshot::ListUpload const &upload = snapshot.list_uploads[u];
+		if (upload.list >= list_buffers.size()) list_buffers.resize(upload.list + 1);
+		ListBuffer &list = list_buffers[upload.list];
+		if (list.buffer == 0) glGenBuffers(1, &list.buffer);
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment <= 0) alignment = 256;
+		list.stride = (sizeof(ObjectUniforms) + alignment - 1) / alignment * alignment;
+		std::vector< uint8_t > staging(upload.uniforms.size() * list.stride);
+		for (uint32_t c = 0; c < upload.uniforms.size(); ++c) {
+			std::memcpy(staging.data() + c * list.stride, &upload.uniforms[c], sizeof(ObjectUniforms));
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, list.buffer);
+		glBufferData(GL_UNIFORM_BUFFER, staging.size(), staging.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		render_stats.buffer_uploads += 1;
+		render_stats.upload_bytes += uint32_t(staging.size());
+	}
 
-		//compute modelview (object space to camera local space) matrix for this object:
-		glm::mat4 mv = local_to_world;
+	//per-object data for (non-command-list) objects using the 'Object' block is copied in one pass into the ring buffer:
+	uint32_t block_count = 0;
+	for (uint32_t i = snapshot.list_item_count; i < items.size(); ++i) {
+		if (items[i].object_block) ++block_count;
+	}
+	object_ring.begin(block_count, sizeof(ObjectUniforms));
+	{
+		uint32_t b = 0;
+		for (uint32_t i = snapshot.list_item_count; i < items.size(); ++i) {
+			if (!items[i].object_block) continue;
+			*reinterpret_cast< ObjectUniforms * >(object_ring.block(b)) = items[i].uniforms;
+			++b;
+		}
+		assert(b == block_count);
+	}
+	object_ring.end();
+	if (block_count > 0) {
+		render_stats.buffer_uploads += 1;
+		render_stats.upload_bytes += block_count * uint32_t(sizeof(ObjectUniforms));
+	}
+
+	//bind the 'Object' block for an item (b counts ring blocks used so far):
+	auto bind_object_block = [this](DrawItem const &item, uint32_t *b) {
+		if (item.command_list != -1U) {
+			ListBuffer const &list = list_buffers[item.command_list];
+			glBindBufferRange(GL_UNIFORM_BUFFER, ObjectBinding, list.buffer, item.command_index * list.stride, sizeof(ObjectUniforms));
+		} else {
+			object_ring.bind(ObjectBinding, *b);
+			*b += 1;
+		}
+		render_stats.block_binds += 1;
+	};
+
+	//occlusion culling -- read results of the queries issued by the last draw:
+	// (objects the camera is inside of are never culled, since their box's faces may be behind the camera)
+	auto camera_inside = [&snapshot](DrawItem const &item) {
+		glm::vec3 local = glm::vec3(glm::inverse(item.uniforms.object_to_light) * glm::vec4(snapshot.camera_position, 1.0f));
+		glm::vec3 margin = 0.01f * (item.bounds_max - item.bounds_min) + glm::vec3(0.1f);
+		glm::vec3 min = item.bounds_min - margin;
+		glm::vec3 max = item.bounds_max + margin;
+		return (min.x <= local.x && local.x <= max.x)
+		    && (min.y <= local.y && local.y <= max.y)
+		    && (min.z <= local.z && local.z <= max.z);
+	};
+	if (snapshot.occlusion_culling) {
+		for (auto &item : items) {
+			if (item.occlusion_slot == -1U) continue;
+			item.hidden = occlusion_queries.hidden(item.occlusion_slot, item.occlusion_generation) && !camera_inside(item);
+		}
+	}
 
-		//NOTE: inverse cancels out transpose unless there is scale involved
-		glm::mat3 itmv = glm::inverse(glm::transpose(glm::mat3(mv)));
+	uint32_t current_material = -1U;
+	GLuint current_program = -1U;
+	GLuint current_vao = -1U;
 
-		//set up program uniforms:
-		glUseProgram(object->program);
-		if (object->program_mvp_mat4 != -1U) {
-			glUniformMatrix4fv(object->program_mvp_mat4, 1, GL_FALSE, glm::value_ptr(mvp));
+	//make a material current (only if it isn't already):
+	auto use_material = [&](uint32_t index) {
+		if (index == current_material) return;
+		Material const &material = materials[index];
+		if (material.program != current_program) {
+			glUseProgram(material.program);
+			current_program = material.program;
+			render_stats.program_switches += 1;
 		}
-		if (object->program_mv_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(object->program_mv_mat4x3, 1, GL_FALSE, glm::value_ptr(mv));
+		for (auto const &p : material.parameters) {
+			if (p.location == -1U) continue;
+			render_stats.uniform_calls += 1;
+			if (p.components == 1) glUniform1fv(p.location, 1, glm::value_ptr(p.value));
+			else if (p.components == 2) glUniform2fv(p.location, 1, glm::value_ptr(p.value));
+			else if (p.components == 3) glUniform3fv(p.location, 1, glm::value_ptr(p.value));
+			else glUniform4fv(p.location, 1, glm::value_ptr(p.value));
 		}
-		if (object->program_itmv_mat3 != -1U) {
-			glUniformMatrix3fv(object->program_itmv_mat3, 1, GL_FALSE, glm::value_ptr(itmv));
+		if (material.set_uniforms) material.set_uniforms();
+		current_material = index;
+	};
+	auto use_vao = [&](GLuint vao) {
+		if (vao == current_vao) return;
+		glBindVertexArray(vao);
+		current_vao = vao;
+		render_stats.vao_switches += 1;
+	};
+
+	//depth pre-pass -- draw depth only for objects whose material allows it:
+	GLint depth_func = GL_LESS;
+	if (snapshot.depth_prepass) {
+		if (depth_prepass_program == 0) {
+			depth_prepass_program = compile_program(
+				"#version 330\n"
+				"layout(std140) uniform Frame {\n"
+				"	mat4 world_to_clip;\n"
+				"};\n"
+				"layout(std140) uniform Object {\n"
+				"	mat4x3 object_to_light;\n"
+				"};\n"
+				"layout(location=0) in vec4 Position;\n"
+				"invariant gl_Position;\n"
+				"void main() {\n"
+				"	gl_Position = world_to_clip * vec4(object_to_light * Position, 1.0);\n"
+				"}\n"
+				,
+				"#version 330\n"
+				"void main() {\n"
+				"}\n"
+			);
+			GLuint frame_index = glGetUniformBlockIndex(depth_prepass_program, "Frame");
+			if (frame_index != GL_INVALID_INDEX) glUniformBlockBinding(depth_prepass_program, frame_index, FrameBinding);
+			GLuint object_index = glGetUniformBlockIndex(depth_prepass_program, "Object");
+			if (object_index != GL_INVALID_INDEX) glUniformBlockBinding(depth_prepass_program, object_index, ObjectBinding);
 		}
 
-		if (object->set_uniforms) object->set_uniforms();
+		GLboolean color_mask[4];
+		glGetBooleanv(GL_COLOR_WRITEMASK, color_mask);
+		glGetIntegerv(GL_DEPTH_FUNC, &depth_func);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glUseProgram(depth_prepass_program);
+		current_program = depth_prepass_program;
+		render_stats.program_switches += 1;
 
-		glBindVertexArray(object->vao);
+		uint32_t b = 0;
+		for (auto const &item : items) {
+			if (!item.object_block) continue;
+			if (item.material == -1U || !materials[item.material].depth_prepass || item.hidden) {
+				if (item.command_list == -1U) ++b; //(skip this item's ring block)
+				continue;
+			}
+			bind_object_block(item, &b);
+			use_vao(item.vao);
+			MeshBuffer::draw_range(item.indexed, item.start, item.count);
+			render_stats.draw_calls += 1;
+			render_stats.triangles += item.count / 3;
+		}
 
-		//draw the object:
-		glDrawArrays(GL_TRIANGLES, object->start, object->count);
+		glColorMask(color_mask[0], color_mask[1], color_mask[2], color_mask[3]);
+		glDepthFunc(GL_LEQUAL);
 	}
+
+	//count samples shaded by the main pass:
+	// (a result is reported only by the draw that reads it, tagged with the settings of the draw it measured)
+	snapshot.sample_count = SampleCount();
+	if (snapshot.count_samples) {
+		if (samples_query == 0) glGenQueries(1, &samples_query);
+		if (samples_query_issued) {
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(samples_query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				glGetQueryObjectuiv(samples_query, GL_QUERY_RESULT, &samples_query_draw.samples);
+				samples_query_draw.valid = true;
+				samples_query_issued = false;
+				snapshot.sample_count = samples_query_draw;
+				render_stats.samples_shaded += samples_query_draw.samples;
+				render_stats.sampled_pixels += samples_query_draw.pixels;
+			}
+		}
+		if (!samples_query_issued) {
+			GLint viewport[4] = {0, 0, 0, 0};
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			samples_query_draw = SampleCount();
+			samples_query_draw.pixels = uint32_t(viewport[2]) * uint32_t(viewport[3]);
+			samples_query_draw.sort_front_to_back = snapshot.sort_front_to_back;
+			samples_query_draw.depth_prepass = snapshot.depth_prepass;
+			glBeginQuery(GL_SAMPLES_PASSED, samples_query);
+		}
+	}
+
+	//main pass (command-list objects first, then the rest in draw_list order):
+	snapshot.drawn_count = 0;
+	snapshot.culled_count = 0;
+	uint32_t b = 0;
+	for (auto const &item : items) {
+		if (item.hidden) {
+			++snapshot.culled_count;
+			if (item.object_block && item.command_list == -1U) ++b; //(block was written anyway)
+			continue;
+		}
+		++snapshot.drawn_count;
+
+		if (item.material != -1U) {
+			use_material(item.material);
+		} else {
+			current_material = -1U;
+			DrawSnapshot::Legacy const &legacy = snapshot.legacy[item.legacy];
+			if (legacy.program != current_program) {
+				glUseProgram(legacy.program);
+				current_program = legacy.program;
+				render_stats.program_switches += 1;
+			}
+			if (!item.object_block) {
+				//modelview+projection (object space to clip space) matrix for this object:
+				glm::mat4 const &mvp = item.object_to_clip;
+
+				//modelview (object space to lighting space) matrix for this object:
+				glm::mat4 const &mv = item.uniforms.object_to_light;
+
+				//normal matrix (inverse transpose of modelview):
+				glm::mat3 itmv = glm::mat3(item.uniforms.normal_to_light);
+
+				//set up program uniforms:
+				if (legacy.program_mvp_mat4 != -1U) {
+					glUniformMatrix4fv(legacy.program_mvp_mat4, 1, GL_FALSE, glm::value_ptr(mvp));
+					render_stats.uniform_calls += 1;
+				}
+				if (legacy.program_mv_mat4x3 != -1U) {
+					glUniformMatrix4x3fv(legacy.program_mv_mat4x3, 1, GL_FALSE, glm::value_ptr(mv));
+					render_stats.uniform_calls += 1;
+				}
+				if (legacy.program_itmv_mat3 != -1U) {
+					glUniformMatrix3fv(legacy.program_itmv_mat3, 1, GL_FALSE, glm::value_ptr(itmv));
+					render_stats.uniform_calls += 1;
+				}
+			}
+			if (legacy.set_uniforms) legacy.set_uniforms();
+		}
+
+		if (item.object_block) bind_object_block(item, &b);
+
+		use_vao(item.vao);
+
+		//draw the object (at the level of detail picked by prepare_draw):
+		MeshBuffer::draw_range(item.indexed, item.start, item.count);
+		render_stats.draw_calls += 1;
+		render_stats.triangles += item.count / 3;
+	}
+
+	if (snapshot.count_samples && !samples_query_issued) {
+		glEndQuery(GL_SAMPLES_PASSED);
+		samples_query_issued = true;
+	}
+	if (snapshot.depth_prepass) glDepthFunc(GLenum(depth_func));
+
+	//occlusion culling -- test every bounded object's box against the finished depth buffer:
+	if (snapshot.occlusion_culling) {
+		occlusion_queries.begin();
+		for (auto const &item : items) {
+			if (item.occlusion_slot == -1U) continue;
+			if (camera_inside(item)) continue;
+			//(slightly enlarged so that boxes don't z-fight with the surfaces they enclose)
+			glm::vec3 margin = 0.01f * (item.bounds_max - item.bounds_min) + glm::vec3(0.001f);
+			occlusion_queries.issue(item.occlusion_slot, item.occlusion_generation,
+				snapshot.frame_uniforms.world_to_clip * item.uniforms.object_to_light, item.bounds_min - margin, item.bounds_max + margin);
+		}
+		occlusion_queries.end();
+	}
+
+	//mark this frame's part of the ring as in-use by the GPU:
+	object_ring.fence();
 }
 
 
 Scene::~Scene() {
+	clear();
+	if (depth_prepass_program != 0) {
+		glDeleteProgram(depth_prepass_program);
+		depth_prepass_program = 0;
+	}
+	if (samples_query != 0) {
+		glDeleteQueries(1, &samples_query);
+		samples_query = 0;
+	}
+	for (auto &list : list_buffers) {
+		if (list.buffer != 0) {
+			glDeleteBuffers(1, &list.buffer);
+			list.buffer = 0;
+		}
+	}
+}
+
+void Scene::clear() {
+	while (first_lamp) {
+		delete_lamp(first_lamp);
+	}
 	while (first_camera) {
 		delete_camera(first_camera);
 	}
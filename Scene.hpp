@@ -1,6 +1,12 @@
 #pragma once
 
 #include "GL.hpp"
+#include "UniformBuffers.hpp"
+#include "Pool.hpp"
+#include "OcclusionQueries.hpp"
+
+struct WorkerPool;
+struct SpatialIndex;
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -8,11 +14,74 @@
 #include <vector>
 #include <list>
 #include <functional>
+#include <string>
 
 //"Scene" manages a hierarchy of transformations with, potentially, attached information.
 struct Scene {
 
+	//"Handle"s name transforms, objects, and cameras without pointing at them:
+	// Scene keeps a table of slots for each type, and deleting an item bumps its slot's generation,
+	// so looking up a stale handle gives nullptr instead of a dangling pointer.
+	//(use Scene::handle() to get an item's handle and Scene::lookup() to get the item back)
+	template< typename T >
+	struct Handle {
+		uint32_t index = -1U; //slot in the table
+		uint32_t generation = 0; //(slot generations start at 1, so default-constructed handles never match)
+		bool operator==(Handle const &other) const {
+			return index == other.index && generation == other.generation;
+		}
+		bool operator!=(Handle const &other) const {
+			return !(*this == other);
+		}
+	};
+
+	template< typename T >
+	struct HandleTable {
+		struct Slot {
+			T *item = nullptr;
+			uint32_t generation = 1;
+		};
+		std::vector< Slot > slots;
+		std::vector< uint32_t > free_slots; //(reused before slots grows, so steady-state churn doesn't allocate)
+
+		Handle< T > add(T *item) {
+			uint32_t index;
+			if (!free_slots.empty()) {
+				index = free_slots.back();
+				free_slots.pop_back();
+			} else {
+				index = uint32_t(slots.size());
+				slots.emplace_back();
+				//(room to free every slot, so deleting never allocates)
+				if (free_slots.capacity() < slots.capacity()) free_slots.reserve(slots.capacity());
+			}
+			slots[index].item = item;
+			return handle(index);
+		}
+		void remove(uint32_t index) {
+			assert(index < slots.size() && slots[index].item);
+			slots[index].item = nullptr;
+			slots[index].generation += 1;
+			free_slots.emplace_back(index);
+		}
+		Handle< T > handle(uint32_t index) const {
+			assert(index < slots.size());
+			Handle< T > ret;
+			ret.index = index;
+			ret.generation = slots[index].generation;
+			return ret;
+		}
+		T *lookup(Handle< T > const &handle) const {
+			if (handle.index >= slots.size()) return nullptr;
+			Slot const &slot = slots[handle.index];
+			return (slot.generation == handle.generation ? slot.item : nullptr);
+		}
+	};
+
 	struct Transform {
+		//name (set when loaded from a file):
+		std::string name;
+
 		//simple specification:
 		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
 		glm::quat rotation = glm::quat(0.0f, 0.0f, 0.0f, 1.0f);
@@ -52,6 +121,52 @@ struct Scene {
 		//used by Scene to manage allocation:
 		Transform **alloc_prev_next = nullptr;
 		Transform *alloc_next = nullptr;
+
+		//used by Scene to find this transform's handle:
+		uint32_t handle_index = -1U;
+
+		//used by Scene to find this transform in the flattened hierarchy:
+		uint32_t flat_index = -1U;
+		//owning Scene's hierarchy_version (set by Scene::new_transform), incremented whenever this transform's parent changes:
+		uint32_t *hierarchy_version = nullptr;
+	};
+
+	//"Material"s hold program info and parameters shared by many objects:
+	// (objects refer to materials by index in Scene::materials, and draw() sorts by material
+	//  so that programs are switched and parameters uploaded only when the material changes)
+	struct Material {
+		//program info:
+		GLuint program = 0;
+		GLuint program_mvp_mat4 = -1U; //uniform index for object-to-clip matrix (mat4)
+		GLuint program_mv_mat4x3 = -1U; //uniform index for model-to-lighting-space matrix (mat4x3)
+		GLuint program_itmv_mat3 = -1U; //uniform index for normal-to-lighting-space matrix (mat3)
+
+		//if set, matrices are supplied through the 'Object' uniform block (see ObjectUniforms) instead of the uniform indices above:
+		bool object_block = false;
+
+		//if set (along with object_block), objects are also drawn by the depth pre-pass (see Scene::depth_prepass):
+		// the program must read 'Position' from attribute location 0 and compute an 'invariant gl_Position'
+		// as world_to_clip * vec4(object_to_light * Position, 1.0), so depths match the pre-pass exactly.
+		bool depth_prepass = false;
+
+		//parameters (e.g. glossiness), uploaded whenever the material becomes current:
+		struct Parameter {
+			GLuint location = -1U; //uniform location (-1U means slot is unused)
+			GLuint components = 0; //number of floats (1-4)
+			glm::vec4 value = glm::vec4(0.0f);
+		};
+		static constexpr uint32_t MaxParameters = 4;
+		Parameter parameters[MaxParameters];
+		//set a parameter (note: will throw if all slots are in use by other locations):
+		void set_parameter(GLuint location, float value);
+		void set_parameter(GLuint location, glm::vec2 const &value);
+		void set_parameter(GLuint location, glm::vec3 const &value);
+		void set_parameter(GLuint location, glm::vec4 const &value);
+		void set_parameter(GLuint location, GLuint components, glm::vec4 const &value);
+
+		//called (after parameters are uploaded) whenever the material becomes current;
+		// use for anything the parameter slots can't express:
+		std::function< void() > set_uniforms;
 	};
 
 	//"Object"s contain information needed to render meshes:
@@ -61,21 +176,57 @@ struct Scene {
 			assert(transform);
 		}
 
-		//program info:
+		//material info:
+		uint32_t material = -1U; //index into Scene::materials
+
+		//per-object program info (only used if 'material' is -1U):
+		// NOTE: this is the old interface, kept so existing code keeps working; to migrate, move these fields
+		//  into a Material (set_uniforms becomes Material::parameters or Material::set_uniforms) and set 'material'.
 		GLuint program = 0;
 		GLuint program_mvp_mat4 = -1U; //uniform index for object-to-clip matrix (mat4)
 		GLuint program_mv_mat4x3 = -1U; //uniform index for model-to-lighting-space matrix (mat4x3)
 		GLuint program_itmv_mat3 = -1U; //uniform index for normal-to-lighting-space matrix (mat3)
-
-		//material info:
+		bool object_block = false; //(as in Material)
 		std::function< void() > set_uniforms; //will be called before rendering object, use to set material parameters (e.g. glossiness)
 
 		//attribute info:
 		GLuint vao = 0;
 		GLuint start = 0;
 		GLuint count = 0;
+		bool indexed = false; //start/count (and those of lods) are a range of indices in vao's element buffer (see MeshBuffer::Mesh)
+		//for quantized meshes, object-space position is position_offset + position_scale * Position (see MeshBuffer::Mesh):
+		// (applied as part of the 'Object' block's object_to_light matrix, so shaders need no changes)
+		glm::vec3 position_offset = glm::vec3(0.0f);
+		glm::vec3 position_scale = glm::vec3(1.0f);
+
+		//level-of-detail info (optional):
+		// if lod_count > 0, draw() ignores start/count and instead draws one of lods[0 .. lod_count-1],
+		// picking the coarsest level whose 'distance' the object is beyond (as seen from the camera).
+		// all levels share 'vao', so they must come from the same MeshBuffer (see MeshBuffer::lookup_lods).
+		struct LOD {
+			GLuint start = 0;
+			GLuint count = 0;
+			float distance = 0.0f; //switch to this level beyond this distance (lods[0].distance is ignored)
+		};
+		static constexpr uint32_t MaxLODs = 4;
+		LOD lods[MaxLODs];
+		uint32_t lod_count = 0;
+		uint32_t lod = 0; //level selected by the last draw()
+
+		//object-space bounding box (optional; objects with bounds can be occlusion culled, see Scene::occlusion_culling):
+		bool has_bounds = false;
+		glm::vec3 bounds_min = glm::vec3(0.0f);
+		glm::vec3 bounds_max = glm::vec3(0.0f);
+
+		//occlusion culling state (managed by Scene):
+		uint32_t occlusion_slot = -1U; //slot in Scene::occlusion_queries
+
+		//command list this object was recorded into (managed by Scene, see Scene::record_commands):
+		uint32_t command_list = -1U; //index into Scene::command_lists
+		uint32_t command_index = -1U; //index into that list's commands
 
 		//used by Scene to manage allocation:
+		uint32_t handle_index = -1U;
 		Object **alloc_prev_next = nullptr;
 		Object *alloc_next = nullptr;
 	};
@@ -96,20 +247,55 @@ struct Scene {
 		glm::mat4 make_projection() const;
 
 		//used by Scene to manage allocation:
+		uint32_t handle_index = -1U;
 		Camera **alloc_prev_next = nullptr;
 		Camera *alloc_next = nullptr;
 	};
 
+	//"Lamp"s contain information about light sources (as exported from blender):
+	struct Lamp {
+		Transform *transform; //lamps must be attached to transforms.
+		Lamp(Transform *transform_) : transform(transform_) {
+			assert(transform);
+		}
+		//NOTE: directional and spot lamps shine along their -z axis
+
+		enum Type : char {
+			Point = 'p',
+			Hemisphere = 'h',
+			Spot = 's',
+			Directional = 'd'
+		} type = Point;
+		glm::vec3 color = glm::vec3(1.0f); //linear color (0-1)
+		float energy = 1.0f; //intensity multiplier
+		float distance = 30.0f; //falloff distance
+		float spot_fov = glm::radians(45.0f); //cone angle (in radians, spot lamps only)
+
+		//used by Scene to manage allocation:
+		Lamp **alloc_prev_next = nullptr;
+		Lamp *alloc_next = nullptr;
+	};
+
 	//------ functions to create / destroy scene things -----
 	//NOTE: all scene objects are automatically freed when scene is deallocated
+	//NOTE: memory is pooled, so deleted (or clear()'d) things are recycled by later new_* calls
+
+	//Add a material to the material table, returns its index:
+	// (materials are kept by clear(), so they only need to be created once)
+	uint32_t new_material(Material const &material);
+	std::vector< Material > materials;
 
 	//Create a new transform:
 	Transform *new_transform();
+	//Create 'count' new transforms, appending them to 'out':
+	void new_transforms(uint32_t count, std::vector< Transform * > *out);
 	//Delete an existing transform: (NOTE: it is an error to delete a transform with an attached Object or Camera)
 	void delete_transform(Transform *);
 
 	//Create a new object attached to a transform:
 	Object *new_object(Transform *transform);
+	//Create one new object attached to each of 'transforms', appending them to 'out':
+	void new_objects(std::vector< Transform * > const &transforms, std::vector< Object * > *out);
 	//Delete an object:
 	void delete_object(Object *);
 
@@ -118,18 +304,311 @@ struct Scene {
 	//Delete a camera:
 	void delete_camera(Camera *);
 
+	//Create a new lamp attached to a transform:
+	Lamp *new_lamp(Transform *transform);
+	//Delete a lamp:
+	void delete_lamp(Lamp *);
+
 	//used to manage allocated objects:
 	Transform *first_transform = nullptr;
 	Object *first_object = nullptr;
 	Camera *first_camera = nullptr;
+	Lamp *first_lamp = nullptr;
 	//(you shouldn't be manipulating these pointers directly
 
+	//Delete all transforms, objects, cameras, and lamps (materials are kept):
+	// memory stays in the pools below, so re-building a similar scene afterward doesn't allocate
+	void clear();
+
+	//if set, deleted objects are also removed from this index (see SpatialIndex.hpp):
+	SpatialIndex *spatial_index = nullptr;
+
+	//storage for the things above:
+	Pool< Transform > transform_pool;
+	Pool< Object > object_pool;
+	Pool< Camera > camera_pool;
+	Pool< Lamp > lamp_pool;
+
+	//handles (see Handle, above):
+	typedef Handle< Transform > TransformHandle;
+	typedef Handle< Object > ObjectHandle;
+	typedef Handle< Camera > CameraHandle;
+	TransformHandle handle(Transform const *transform) const {
+		return transform_handles.handle(transform->handle_index);
+	}
+	ObjectHandle handle(Object const *object) const {
+		return object_handles.handle(object->handle_index);
+	}
+	CameraHandle handle(Camera const *camera) const {
+		return camera_handles.handle(camera->handle_index);
+	}
+	//returns nullptr if the item has been deleted:
+	Transform *lookup(TransformHandle const &handle) const {
+		return transform_handles.lookup(handle);
+	}
+	Object *lookup(ObjectHandle const &handle) const {
+		return object_handles.lookup(handle);
+	}
+	Camera *lookup(CameraHandle const &handle) const {
+		return camera_handles.lookup(handle);
+	}
+	HandleTable< Transform > transform_handles;
+	HandleTable< Object > object_handles;
+	HandleTable< Camera > camera_handles;
+
+	//------ flattened hierarchy -----
+	//Transforms in an order where parents come before their children, so that all world matrices
+	// can be computed in one linear pass (instead of walking parent pointers for every transform).
+	//The order is only rebuilt when hierarchy_version changes.
+
+	//rebuild the order if needed, then compute world_matrices (called by prepare_draw):
+	void update_world_matrices();
+	//world matrix computed by the last update_world_matrices():
+	glm::mat4 const &world_matrix(Transform const *transform) const {
+		assert(transform->flat_index < world_matrices.size() && flat_transforms[transform->flat_index] == transform);
+		return world_matrices[transform->flat_index];
+	}
+
+	std::vector< Transform * > flat_transforms; //parents before children
+	std::vector< uint32_t > flat_parents; //index of parent in flat_transforms (or -1U)
+	std::vector< glm::mat4 > world_matrices; //local-to-world for each of flat_transforms
+	uint32_t flat_version = -1U; //hierarchy_version when flat_transforms was built
+	//incremented whenever one of this scene's transforms changes parent, or transforms are created/deleted:
+	uint32_t hierarchy_version = 0;
+
+	//------ functions to load scene things -----
+
+	//Add the contents of a '.scene' file (as written by meshes/export-scene.py) to this scene:
+	// transforms are named after the blender objects,
+	// cameras and lamps are created, and 'on_mesh' is called with each transform that references a mesh
+	// (use it to, e.g., look up the mesh by name and create an Object)
+	// note: will throw if file fails to read.
+	void load(std::string const &filename,
+		std::function< void(Scene &, Transform *, std::string const &mesh_name) > const &on_mesh = nullptr);
+
+	//------ uniform blocks ------
+	//Programs may declare these std140 blocks and bind them (glUniformBlockBinding) to the matching binding points:
+	enum UniformBinding : GLuint {
+		FrameBinding = 0, //'Frame' block (FrameUniforms), uploaded once per draw()
+		ObjectBinding = 1 //'Object' block (ObjectUniforms), one per object with object_block set
+	};
+
+	struct FrameUniforms {
+		glm::mat4 world_to_clip = glm::mat4(1.0f); //filled in by draw()
+		glm::vec4 sun_direction = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f); //(std140 vec3s are padded to vec4)
+		glm::vec4 sun_color = glm::vec4(1.0f);
+		glm::vec4 sky_direction = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+		glm::vec4 sky_color = glm::vec4(0.0f);
+	};
+	static_assert(sizeof(FrameUniforms) == 4*4*4 + 4*4*4, "FrameUniforms matches std140 layout.");
+
+	struct ObjectUniforms {
+		glm::mat4 object_to_light; //std140 'mat4x3': four vec3 columns, each padded to vec4
+		glm::mat3x4 normal_to_light; //std140 'mat3': three vec3 columns, each padded to vec4
+	};
+	static_assert(sizeof(ObjectUniforms) == 4*4*4 + 3*4*4, "ObjectUniforms matches std140 layout.");
+
+	//set lighting here before calling draw():
+	FrameUniforms frame_uniforms;
+
+	//draw order: (material, vao) so that state changes only when needed, then (with sort_front_to_back) view depth:
+	struct DrawKey {
+		uint64_t state; //material (high 32 bits; -1U, for objects without a material, sorts last) and vao
+		uint32_t depth; //bit pattern of the (non-negative) view depth, or 0 when not sorting by depth
+		bool operator<(DrawKey const &other) const {
+			if (state != other.state) return state < other.state;
+			return depth < other.depth;
+		}
+	};
+
+	//objects in submission order (sorted by DrawKey), kept between draws to avoid re-allocation:
+	std::vector< std::pair< DrawKey, Object * > > draw_list;
+
+	//if set, objects with the same material and vao are drawn nearest-first, so that later (hidden) fragments
+	// fail the depth test before shading; depth is measured to the center of an object's bounds (or its origin):
+	bool sort_front_to_back = false;
+
+	//if set, objects whose material has depth_prepass are first drawn to the depth buffer only, with a trivial shader;
+	// the main pass then uses GL_LEQUAL and so shades only the nearest fragment at each pixel:
+	bool depth_prepass = false;
+
+	//if set, submit_draw() counts the samples that pass the depth test in the main (shading) pass:
+	// (uses a GL_SAMPLES_PASSED query, read a few frames later; see sample_count and RenderStats::samples_shaded)
+	bool count_samples = false;
+
+	//a GL_SAMPLES_PASSED result, along with the settings of the draw it measured:
+	// (a query spans one draw and is read by a later one, so settings may have changed in between)
+	struct SampleCount {
+		bool valid = false; //false if no result was read
+		uint32_t samples = 0; //samples shaded by the main pass
+		uint32_t pixels = 0; //viewport size of the measured draw
+		bool sort_front_to_back = false;
+		bool depth_prepass = false;
+	};
+
+	//if set, objects with bounds are skipped while their bounding box was hidden in the previous draw():
+	// (boxes are tested with GPU occlusion queries after each draw; results are read one draw later, so
+	//  objects that come into view may appear a frame late)
+	bool occlusion_culling = false;
+	glm::vec3 camera_position = glm::vec3(0.0f); //world-space camera position used by the last prepare_draw()
+
+	//objects switch LOD only once they are this fraction past a switch distance (avoids flickering at the boundary):
+	float lod_hysteresis = 0.1f;
+
+	//if set, prepare_draw() splits matrix computation across this pool's threads:
+	WorkerPool *worker_pool = nullptr;
+
+	//------ draw snapshots ------
+	//prepare_draw() copies everything submit_draw() needs into a DrawSnapshot, so submit_draw() never looks at
+	// transforms or objects. This lets submit_draw() run on a render thread (see RenderThread.hpp) while
+	// the main thread updates the scene and prepares the next snapshot.
+	//There are two snapshots, which prepare_draw() alternates between; so a snapshot is left alone until the
+	// second prepare_draw() after the one that filled it, by which time its submit_draw() must be finished.
+	//NOTE: submit_draw() also reads 'materials', so add materials before starting a render thread.
+
+	struct DrawItem {
+		ObjectUniforms uniforms; //object-to-world and normal-to-world (as uploaded to the 'Object' block)
+		glm::mat4 object_to_clip; //only used by objects without object_block
+		uint32_t material; //index into materials, or -1U (then see 'legacy')
+		GLuint vao;
+		GLuint start; //range to draw (level of detail already picked)
+		GLuint count;
+		bool indexed;
+		bool object_block;
+		uint32_t command_list; //for objects drawn from a command list: its index (otherwise -1U)
+		uint32_t command_index; // ...and the object's index in it
+		uint32_t legacy; //for objects without a material: index into DrawSnapshot::legacy
+		//occlusion culling (occlusion_slot is -1U for objects without bounds):
+		uint32_t occlusion_slot;
+		uint32_t occlusion_generation;
+		glm::vec3 bounds_min;
+		glm::vec3 bounds_max;
+		bool hidden; //(set by submit_draw)
+	};
+
+	struct DrawSnapshot {
+		FrameUniforms frame_uniforms;
+		glm::vec3 camera_position = glm::vec3(0.0f);
+		bool occlusion_culling = false;
+		bool sort_front_to_back = false;
+		bool depth_prepass = false;
+		bool count_samples = false;
+
+		//command-list objects (in list order) followed by draw_list objects:
+		std::vector< DrawItem > items;
+		uint32_t list_item_count = 0;
+
+		//command lists whose matrices changed, to be uploaded before drawing:
+		// (only the first 'list_upload_count' entries are used, so vectors are kept between draws)
+		struct ListUpload {
+			uint32_t list = -1U;
+			std::vector< ObjectUniforms > uniforms;
+		};
+		std::vector< ListUpload > list_uploads;
+		uint32_t list_upload_count = 0;
+
+		//per-object program info for objects without a material:
+		struct Legacy {
+			GLuint program;
+			GLuint program_mvp_mat4;
+			GLuint program_mv_mat4x3;
+			GLuint program_itmv_mat3;
+			std::function< void() > set_uniforms;
+		};
+		std::vector< Legacy > legacy;
+
+		//results, written by submit_draw():
+		uint32_t drawn_count = 0;
+		uint32_t culled_count = 0;
+		SampleCount sample_count; //result read by this draw (if any)
+	};
+	DrawSnapshot snapshots[2];
+	uint32_t snapshot_index = 0; //snapshot filled by the last prepare_draw()
+
+	//results of the most recent finished submit_draw():
+	// (copied by draw(); or, when calling prepare_draw()/submit_draw() separately, by prepare_draw() as it re-uses a snapshot)
+	uint32_t drawn_count = 0; //objects drawn (including from command lists)
+	uint32_t culled_count = 0; //objects skipped by occlusion culling
+	SampleCount sample_count; //sample count read by that draw (if count_samples is set and a result was ready)
+
+	//------ render-side state ------
+	//Used only by submit_draw() (so, with a render thread, only on that thread):
+	// (except occlusion_queries's slot management, which prepare_draw() and delete_object() use; see OcclusionQueries.hpp)
+	UniformBlock frame_block;
+	UniformRing object_ring;
+	OcclusionQueries occlusion_queries;
+	GLuint depth_prepass_program = 0; //(created on first use)
+	GLuint samples_query = 0;
+	bool samples_query_issued = false;
+	SampleCount samples_query_draw; //settings of the draw samples_query is counting
+	//command lists' matrices on the GPU:
+	struct ListBuffer {
+		GLuint buffer = 0; //ObjectUniforms, at 'stride' intervals
+		GLsizeiptr stride = 0;
+	};
+	std::vector< ListBuffer > list_buffers; //by command list index
+
+	//------ recorded command lists ------
+	//Static objects can be recorded into a command list: their matrices are uploaded once into a buffer that
+	// stays on the GPU, and submit_draw() replays the list with a minimal loop (bind block + draw per object)
+	// instead of drawing them as part of draw_list.
+	//Recorded lists aren't checked for changes every frame, so:
+	// - deleting a recorded object (or recording the list again) re-records the list automatically;
+	// - re-parenting or creating/deleting transforms (see hierarchy_version) makes prepare_draw compare each
+	//   recorded matrix against the object's current one, re-recording only if they differ;
+	// - anything else that changes a recorded object -- moving its transform (or an ancestor), or changing its
+	//   material, vao, start, count, or indexed -- must be followed by invalidate_command_list(object->command_list).
+	//NOTE: OpenGL 3.3 has no indirect draws, so replay still makes one glDrawArrays call per object.
+
+	struct CommandList {
+		struct Command {
+			Object *object;
+			//recorded values (replayed until the list is re-recorded):
+			uint32_t material;
+			GLuint vao;
+			GLuint start;
+			GLuint count;
+			bool indexed;
+		};
+		std::vector< Command > commands; //sorted by (material, vao)
+		std::vector< std::pair< DrawKey, uint32_t > > order; //(sort key, command index) in draw order, set by prepare_draw
+		std::vector< ObjectUniforms > uniforms; //recorded matrices, one per command
+		bool dirty = false; //needs re-recording (by prepare_draw)
+		uint32_t checked_version = -1U; //Scene::hierarchy_version when last recorded or checked
+		bool needs_upload = false; //needs uploading (prepare_draw copies 'uniforms' into the snapshot for submit_draw)
+	};
+	std::vector< CommandList > command_lists;
+
+	//Add an (empty) command list, returns its index:
+	// (like materials, command lists are kept by clear(), but their contents are not)
+	uint32_t new_command_list();
+	//Replace the contents of a command list with 'objects':
+	// only objects whose material uses the 'Object' block and that have at most one LOD are recorded;
+	// others stay in draw_list.
+	void record_commands(uint32_t list, std::vector< Object * > const &objects);
+	//Re-record a command list in the next prepare_draw (e.g., after moving one of its objects):
+	// (does nothing for list -1U, so invalidate_command_list(object->command_list) is fine for unrecorded objects)
+	void invalidate_command_list(uint32_t list);
+
+	//helpers used by the above and by delete_object / prepare_draw:
+	void remove_from_command_list(Object *object);
+	void update_command_lists(); //re-record invalidated lists, and check lists after hierarchy changes (needs current world matrices)
+
 	//------ functions to traverse the scene ------
 
 	//Draw the scene from a given camera by computing appropriate matrices and sending all objects to OpenGL:
 	//"camera" must be non-null!
 	void draw(Camera const *camera);
 
+	//draw() runs in two phases, which may also be called separately (e.g., on different threads):
+	//prepare_draw() updates world matrices, sorts objects into draw_list, picks LODs, and fills the next snapshot
+	// (no OpenGL calls; uses worker_pool if set):
+	DrawSnapshot &prepare_draw(Camera const *camera);
+	//submit_draw() uploads uniforms and issues OpenGL commands for a snapshot (and writes its results):
+	void submit_draw(DrawSnapshot &snapshot);
+
 
-	~Scene(); //destructor deallocates transforms, objects, cameras
+	Scene() = default;
+	Scene(Scene const &) = delete; //(transforms point back at their scene's hierarchy_version)
+	~Scene(); //destructor deallocates transforms, objects, cameras, lamps
 };
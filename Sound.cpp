@@ -1,4 +1,5 @@
 #include "Sound.hpp"
+#include "AssetPack.hpp"
 
 #include <SDL.h>
 
@@ -205,7 +206,10 @@ Sample::Sample(std::string const &filename) {
 	Uint8 *audio_buf = nullptr;
 	Uint32 audio_len = 0;
 
-	SDL_AudioSpec *have = SDL_LoadWAV(filename.c_str(), &audio_spec, &audio_buf, &audio_len);
+	//(parsed straight from the mapped file or asset pack)
+	DataFile file = open_data_file(filename);
+	SDL_RWops *rw = SDL_RWFromConstMem(file.bytes.data, int(file.bytes.size));
+	SDL_AudioSpec *have = (rw ? SDL_LoadWAV_RW(rw, 1, &audio_spec, &audio_buf, &audio_len) : nullptr);
 	if (!have) {
 		throw std::runtime_error("Failed to load WAV file '" + filename + "'; SDL says \"" + std::string(SDL_GetError()) + "\"");
 	}
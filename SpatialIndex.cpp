@@ -0,0 +1,187 @@
+#include "SpatialIndex.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+SpatialIndex::SpatialIndex(float cell_size_) : cell_size(cell_size_) {
+	assert(cell_size > 0.0f);
+}
+
+glm::ivec3 SpatialIndex::cell_coords(glm::vec3 const &position) const {
+	return glm::ivec3(glm::floor(position / cell_size));
+}
+
+uint64_t SpatialIndex::cell_key(glm::ivec3 const &coords) {
+	//21 bits per axis (coordinates wrap around every 2^21 cells, which just makes distant cells share a bucket):
+	return (uint64_t(uint32_t(coords.x) & 0x1fffff))
+	     | (uint64_t(uint32_t(coords.y) & 0x1fffff) << 21)
+	     | (uint64_t(uint32_t(coords.z) & 0x1fffff) << 42);
+}
+
+void SpatialIndex::insert(Scene::Object *object, uint32_t layers, bool dynamic) {
+	assert(object && object->transform);
+	remove(object);
+	glm::vec3 position = glm::vec3(object->transform->make_local_to_world()[3]);
+	uint64_t key = cell_key(cell_coords(position));
+	cells[key].emplace_back(Item{object, position, layers});
+	entries.emplace(object, Entry{key, dynamic});
+}
+
+void SpatialIndex::remove(Scene::Object *object) {
+	auto f = entries.find(object);
+	if (f == entries.end()) return;
+	auto c = cells.find(f->second.cell);
+	assert(c != cells.end());
+	std::vector< Item > &items = c->second;
+	for (uint32_t i = 0; i < items.size(); ++i) {
+		if (items[i].object == object) {
+			items[i] = items.back();
+			items.pop_back();
+			break;
+		}
+	}
+	//(empty cells are kept so that objects moving back and forth don't re-allocate them)
+	entries.erase(f);
+}
+
+void SpatialIndex::clear() {
+	cells.clear();
+	entries.clear();
+}
+
+void SpatialIndex::move(Scene::Object *object) {
+	auto f = entries.find(object);
+	assert(f != entries.end() && "Can only move objects that are in the index.");
+	glm::vec3 position = glm::vec3(object->transform->make_local_to_world()[3]);
+	uint64_t key = cell_key(cell_coords(position));
+
+	std::vector< Item > &items = cells[f->second.cell];
+	for (uint32_t i = 0; i < items.size(); ++i) {
+		if (items[i].object != object) continue;
+		if (key == f->second.cell) {
+			//same cell, just update position:
+			items[i].position = position;
+		} else {
+			//move to new cell:
+			Item item = items[i];
+			items[i] = items.back();
+			items.pop_back();
+			item.position = position;
+			cells[key].emplace_back(item);
+			f->second.cell = key;
+		}
+		return;
+	}
+	assert(0 && "Object's entry didn't match its cell.");
+}
+
+void SpatialIndex::update() {
+	for (auto &e : entries) {
+		if (e.second.dynamic) move(e.first);
+	}
+}
+
+template< typename F >
+void SpatialIndex::for_each_in_box(glm::vec3 const &min, glm::vec3 const &max, F const &fn) const {
+	glm::ivec3 lo = cell_coords(min);
+	glm::ivec3 hi = cell_coords(max);
+	if (lo.x > hi.x || lo.y > hi.y || lo.z > hi.z) return;
+
+	//if the box covers more cells than are occupied, it's cheaper to just visit the occupied ones:
+	double box_cells = double(hi.x - lo.x + 1) * double(hi.y - lo.y + 1) * double(hi.z - lo.z + 1);
+	if (box_cells > double(cells.size())) {
+		for (auto const &c : cells) {
+			for (auto const &item : c.second) {
+				fn(item);
+			}
+		}
+		return;
+	}
+
+	for (int32_t z = lo.z; z <= hi.z; ++z) {
+		for (int32_t y = lo.y; y <= hi.y; ++y) {
+			for (int32_t x = lo.x; x <= hi.x; ++x) {
+				auto f = cells.find(cell_key(glm::ivec3(x, y, z)));
+				if (f == cells.end()) continue;
+				for (auto const &item : f->second) {
+					fn(item);
+				}
+			}
+		}
+	}
+}
+
+void SpatialIndex::query_radius(glm::vec3 const &center, float radius, std::vector< Scene::Object * > *out, uint32_t layers) const {
+	assert(out);
+	float radius2 = radius * radius;
+	for_each_in_box(center - glm::vec3(radius), center + glm::vec3(radius), [&](Item const &item) {
+		if (!(item.layers & layers)) return;
+		glm::vec3 d = item.position - center;
+		if (glm::dot(d, d) <= radius2) out->emplace_back(item.object);
+	});
+}
+
+void SpatialIndex::query_box(glm::vec3 const &min, glm::vec3 const &max, std::vector< Scene::Object * > *out, uint32_t layers) const {
+	assert(out);
+	for_each_in_box(min, max, [&](Item const &item) {
+		if (!(item.layers & layers)) return;
+		if (item.position.x < min.x || item.position.x > max.x) return;
+		if (item.position.y < min.y || item.position.y > max.y) return;
+		if (item.position.z < min.z || item.position.z > max.z) return;
+		out->emplace_back(item.object);
+	});
+}
+
+Scene::Object *SpatialIndex::query_nearest(glm::vec3 const &at, float max_distance, uint32_t layers) const {
+	Scene::Object *best = nullptr;
+	float best2 = max_distance * max_distance;
+	auto consider = [&](Item const &item) {
+		if (!(item.layers & layers)) return;
+		glm::vec3 d = item.position - at;
+		float d2 = glm::dot(d, d);
+		if (d2 <= best2) {
+			best = item.object;
+			best2 = d2;
+		}
+	};
+	auto visit = [&](glm::ivec3 const &coords) {
+		auto f = cells.find(cell_key(coords));
+		if (f == cells.end()) return;
+		for (auto const &item : f->second) {
+			consider(item);
+		}
+	};
+
+	//search outward in shells of cells around the one containing 'at':
+	glm::ivec3 center = cell_coords(at);
+	uint64_t visited = 0;
+	for (int32_t ring = 0; ; ++ring) {
+		//anything in this shell (or further) is at least (ring - 1) cells away:
+		if (ring > 0) {
+			float closest = float(ring - 1) * cell_size;
+			if (closest * closest > best2) break;
+		}
+		//once the shells cover more cells than are occupied, just check every occupied cell:
+		if (visited > cells.size()) {
+			for (auto const &c : cells) {
+				for (auto const &item : c.second) {
+					consider(item);
+				}
+			}
+			break;
+		}
+		for (int32_t z = -ring; z <= ring; ++z) {
+			for (int32_t y = -ring; y <= ring; ++y) {
+				bool on_face = (z == -ring || z == ring || y == -ring || y == ring);
+				int32_t step = (on_face ? 1 : 2 * std::max(ring, 1)); //(interior rows only need their two ends)
+				for (int32_t x = -ring; x <= ring; x += step) {
+					visit(center + glm::ivec3(x, y, z));
+					++visited;
+				}
+			}
+		}
+	}
+
+	return best;
+}
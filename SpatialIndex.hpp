@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+//"SpatialIndex" is a hashed grid of Scene::Objects for proximity queries:
+// objects are indexed by the world position of their transform's origin,
+// so queries only look at grid cells near the query region instead of every object.
+//Set Scene::spatial_index to have deleted objects removed automatically.
+
+struct SpatialIndex {
+	SpatialIndex(float cell_size = 4.0f);
+	SpatialIndex(SpatialIndex const &) = delete;
+
+	//add an object (or change its layers / dynamic flag, if already present):
+	// 'layers' is a bitmask matched against the 'layers' argument of queries
+	// 'dynamic' objects have their positions re-read by update(); others only by move()
+	void insert(Scene::Object *object, uint32_t layers = 1, bool dynamic = true);
+	//remove an object (does nothing if the object isn't in the index):
+	void remove(Scene::Object *object);
+	//remove everything:
+	void clear();
+
+	//re-read the position of one object (e.g., after moving a non-dynamic object):
+	void move(Scene::Object *object);
+	//re-read the positions of all dynamic objects (call after updating transforms, before querying):
+	void update();
+
+	//queries append matching objects to 'out' (in no particular order):
+	//objects within 'radius' of 'center':
+	void query_radius(glm::vec3 const &center, float radius, std::vector< Scene::Object * > *out, uint32_t layers = -1U) const;
+	//objects inside the box [min, max]:
+	void query_box(glm::vec3 const &min, glm::vec3 const &max, std::vector< Scene::Object * > *out, uint32_t layers = -1U) const;
+	//closest object to 'at' that is no further than 'max_distance' (or nullptr if there isn't one):
+	Scene::Object *query_nearest(glm::vec3 const &at, float max_distance = 1e30f, uint32_t layers = -1U) const;
+
+	//internals:
+	struct Item {
+		Scene::Object *object;
+		glm::vec3 position;
+		uint32_t layers;
+	};
+	struct Entry {
+		uint64_t cell; //key of cell holding the object's Item
+		bool dynamic;
+	};
+	float cell_size;
+	std::unordered_map< uint64_t, std::vector< Item > > cells; //cell key -> items in that cell
+	std::unordered_map< Scene::Object *, Entry > entries;
+
+	glm::ivec3 cell_coords(glm::vec3 const &position) const;
+	static uint64_t cell_key(glm::ivec3 const &coords);
+	//calls fn(item) for every item in cells overlapping [min, max]:
+	template< typename F >
+	void for_each_in_box(glm::vec3 const &min, glm::vec3 const &max, F const &fn) const;
+};
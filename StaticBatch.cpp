@@ -0,0 +1,152 @@
+#include "StaticBatch.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <limits>
+#include <cmath>
+
+StaticBatch::StaticBatch() {
+	glGenBuffers(1, &buffer.vbo);
+
+	//store attrib locations:
+	buffer.Position = MeshBuffer::Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Position));
+	buffer.Normal = MeshBuffer::Attrib(3, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, Normal));
+	buffer.Color = MeshBuffer::Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+}
+
+StaticBatch::~StaticBatch() {
+	for (auto const &lv : buffer.vaos) {
+		glDeleteVertexArrays(1, &lv.second);
+	}
+	buffer.vaos.clear();
+	if (buffer.vbo != 0) {
+		glDeleteBuffers(1, &buffer.vbo);
+		buffer.vbo = 0;
+	}
+}
+
+void StaticBatch::build(MeshBuffer const &source, std::vector< Scene::Object * > const &objects, glm::vec3 const &chunk_size) {
+	if ((source.cpu_data.empty() && source.vertex_count != 0) || (source.cpu_indices.size() != source.index_count)) {
+		throw std::runtime_error("StaticBatch needs a MeshBuffer loaded with KeepCPUCopy.");
+	}
+	bool quantized_positions = (source.Position.size == 3 && source.Position.type == GL_UNSIGNED_SHORT);
+	if (!(source.Position.size == 3 && source.Position.type == GL_FLOAT) && !quantized_positions) {
+		throw std::runtime_error("StaticBatch only supports vec3 float or quantized (u16vec3) positions.");
+	}
+	bool packed_normals = (source.Normal.size == 4 && source.Normal.type == GL_INT_2_10_10_10_REV);
+	if (source.Normal.size != 0 && !(source.Normal.size == 3 && source.Normal.type == GL_FLOAT) && !packed_normals) {
+		throw std::runtime_error("StaticBatch only supports vec3 float or packed (2_10_10_10) normals.");
+	}
+	if (source.Color.size != 0 && !(source.Color.size == 4 && source.Color.type == GL_UNSIGNED_BYTE)) {
+		throw std::runtime_error("StaticBatch only supports u8vec4 colors.");
+	}
+
+	//sort objects by the chunk containing their origin, so each chunk is a contiguous run:
+	std::vector< std::pair< glm::ivec3, Scene::Object * > > keyed;
+	keyed.reserve(objects.size());
+	for (auto object : objects) {
+		assert(object);
+		glm::vec3 at = glm::vec3(object->transform->make_local_to_world()[3]);
+		glm::ivec3 cell = glm::ivec3(0);
+		for (uint32_t c = 0; c < 3; ++c) {
+			if (chunk_size[c] > 0.0f) cell[c] = int32_t(std::floor(at[c] / chunk_size[c]));
+		}
+		keyed.emplace_back(cell, object);
+	}
+	std::stable_sort(keyed.begin(), keyed.end(), [](std::pair< glm::ivec3, Scene::Object * > const &a, std::pair< glm::ivec3, Scene::Object * > const &b) {
+		if (a.first.x != b.first.x) return a.first.x < b.first.x;
+		if (a.first.y != b.first.y) return a.first.y < b.first.y;
+		return a.first.z < b.first.z;
+	});
+
+	vertices.clear();
+	chunks.clear();
+
+	auto read_vec3 = [&source](MeshBuffer::Attrib const &attrib, GLuint index) {
+		glm::vec3 ret;
+		std::memcpy(glm::value_ptr(ret), source.cpu_data.data() + index * attrib.stride + attrib.offset, sizeof(ret));
+		return ret;
+	};
+	auto read_position = [&](Scene::Object const &object, GLuint index) {
+		if (!quantized_positions) return read_vec3(source.Position, index);
+		glm::u16vec3 q;
+		std::memcpy(&q, source.cpu_data.data() + index * source.Position.stride + source.Position.offset, sizeof(q));
+		return object.position_offset + object.position_scale * (glm::vec3(q) / 65535.0f);
+	};
+	auto read_normal = [&](GLuint index) {
+		if (!packed_normals) return read_vec3(source.Normal, index);
+		uint32_t p;
+		std::memcpy(&p, source.cpu_data.data() + index * source.Normal.stride + source.Normal.offset, sizeof(p));
+		//sign-extend each 10-bit component:
+		auto component = [p](uint32_t shift) {
+			int32_t c = int32_t((p >> shift) & 0x3ff);
+			if (c >= 512) c -= 1024;
+			return std::max(-1.0f, float(c) / 511.0f);
+		};
+		return glm::vec3(component(0), component(10), component(20));
+	};
+
+	for (uint32_t k = 0; k < keyed.size(); ++k) {
+		//start a new chunk whenever the cell changes:
+		if (k == 0 || keyed[k].first != keyed[k-1].first) {
+			Chunk chunk;
+			chunk.mesh.start = GLuint(vertices.size());
+			chunk.min = glm::vec3(std::numeric_limits< float >::infinity());
+			chunk.max = glm::vec3(-std::numeric_limits< float >::infinity());
+			chunks.emplace_back(chunk);
+		}
+		Chunk &chunk = chunks.back();
+
+		Scene::Object const &object = *keyed[k].second;
+		//(ranges are offset by where source's data starts in its arena, if any)
+		GLuint source_first = (object.indexed ? source.first_index : source.first_vertex);
+		GLuint source_count = (object.indexed ? source.index_count : source.vertex_count);
+		if (!(source_first <= object.start && object.start <= object.start + object.count && object.start + object.count <= source_first + source_count)) {
+			throw std::runtime_error("StaticBatch object refers to vertices outside of source buffer.");
+		}
+
+		glm::mat4 local_to_world = object.transform->make_local_to_world();
+		glm::mat3 normal_to_world = glm::inverse(glm::transpose(glm::mat3(local_to_world)));
+
+		//(indexed meshes are expanded, since batch vertices are stored as triangles)
+		for (GLuint e = object.start; e < object.start + object.count; ++e) {
+			GLuint i = (object.indexed ? source.cpu_indices[e - source_first] : e - source_first);
+			Vertex v;
+			v.Position = glm::vec3(local_to_world * glm::vec4(read_position(object, i), 1.0f));
+			if (source.Normal.size != 0) {
+				v.Normal = glm::normalize(normal_to_world * read_normal(i));
+			} else {
+				v.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+			}
+			if (source.Color.size != 0) {
+				std::memcpy(&v.Color, source.cpu_data.data() + i * source.Color.stride + source.Color.offset, sizeof(v.Color));
+			} else {
+				v.Color = glm::u8vec4(0xff);
+			}
+			chunk.min = glm::min(chunk.min, v.Position);
+			chunk.max = glm::max(chunk.max, v.Position);
+			vertices.emplace_back(v);
+		}
+		chunk.mesh.count = GLuint(vertices.size()) - chunk.mesh.start;
+	}
+
+	dirty = true;
+}
+
+void StaticBatch::upload() {
+	if (!dirty) return;
+	upload(vertices);
+	dirty = false;
+}
+
+void StaticBatch::upload(std::vector< Vertex > const &vertices_) {
+	glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(Vertex), vertices_.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	buffer.vertex_count = GLuint(vertices_.size());
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "MeshBuffer.hpp"
+#include "Scene.hpp"
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+//"StaticBatch" bakes objects that never move into one world-space vertex buffer,
+// so that (e.g.) a generated level can be drawn with a handful of draw calls.
+//Geometry may optionally be split into a grid of chunks, each with its own bounds (useful for culling).
+
+struct StaticBatch {
+	//creates the (empty) vertex buffer; 'buffer' can be bound to programs right away:
+	StaticBatch();
+	~StaticBatch();
+	StaticBatch(StaticBatch const &) = delete;
+
+	//replace the contents of the batch with world-space copies of the meshes drawn by 'objects':
+	// - every object must draw from 'source', which must have been loaded with MeshBuffer::KeepCPUCopy
+	//   (objects drawing indexed meshes are expanded to triangles)
+	// - objects are grouped into chunks by the grid cell (of size 'chunk_size') containing their origin;
+	//   a chunk_size component of zero means "don't split along this axis"
+	// note: will throw if source has no CPU-side data or has unsupported attribute formats.
+	void build(MeshBuffer const &source, std::vector< Scene::Object * > const &objects, glm::vec3 const &chunk_size = glm::vec3(0.0f));
+
+	//send vertices to the GPU if they have changed since the last upload:
+	void upload();
+
+	//world-space vertices (same layout as a '.pnc' file):
+	struct Vertex {
+		glm::vec3 Position;
+		glm::vec3 Normal;
+		glm::u8vec4 Color;
+	};
+	static_assert(sizeof(Vertex) == 3*4+3*4+4*1, "Vertex is packed.");
+	std::vector< Vertex > vertices;
+
+	//send a copy of 'vertices' to the GPU (e.g., taken on another thread; does not check or clear 'dirty'):
+	void upload(std::vector< Vertex > const &vertices);
+
+	//each chunk is a contiguous range of vertices, drawn with an identity transform:
+	struct Chunk {
+		MeshBuffer::Mesh mesh;
+		glm::vec3 min = glm::vec3(0.0f); //world-space bounds of the chunk
+		glm::vec3 max = glm::vec3(0.0f);
+	};
+	std::vector< Chunk > chunks;
+
+	//'buffer.vbo' holds uploaded vertices, use buffer.make_vao_for_program() to bind it (the batch deletes those vaos):
+	MeshBuffer buffer;
+	bool dirty = false; //vertices changed since last upload
+};
@@ -0,0 +1,100 @@
+#include "UniformBuffers.hpp"
+
+#include <stdexcept>
+#include <cassert>
+
+UniformBlock::~UniformBlock() {
+	if (buffer != 0) {
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
+
+void UniformBlock::set(void const *data, GLsizeiptr size, GLuint binding) {
+	if (buffer == 0) glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, data, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+//---------------------------
+
+UniformRing::~UniformRing() {
+	for (auto &f : fences) {
+		if (f) glDeleteSync(f);
+		f = 0;
+	}
+	if (buffer != 0) {
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+	//(so a ring that is destroyed and then re-used -- e.g., by a scene rebuilt in place -- allocates its new buffer)
+	stride = 0;
+	block_size = 0;
+	segment_size = 0;
+	segment = 0;
+	mapped = nullptr;
+}
+
+void UniformRing::begin(uint32_t count, GLsizeiptr size) {
+	assert(mapped == nullptr && "UniformRing::begin() called twice without end()");
+
+	if (stride == 0 || size != block_size) {
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment <= 0) alignment = 256;
+		block_size = size;
+		stride = (size + alignment - 1) / alignment * alignment;
+		segment_size = 0; //force re-allocation
+	}
+
+	if (buffer == 0) glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+
+	GLsizeiptr needed = GLsizeiptr(count) * stride;
+	if (needed > segment_size) {
+		//grow (at least doubling) -- old contents and fences no longer matter:
+		segment_size = (segment_size * 2 > needed ? segment_size * 2 : needed);
+		glBufferData(GL_UNIFORM_BUFFER, segment_size * Segments, nullptr, GL_STREAM_DRAW);
+		for (auto &f : fences) {
+			if (f) glDeleteSync(f);
+			f = 0;
+		}
+	}
+
+	segment = (segment + 1) % Segments;
+	if (fences[segment]) {
+		//wait for the GPU to finish with this segment (usually already done):
+		glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+		glDeleteSync(fences[segment]);
+		fences[segment] = 0;
+	}
+
+	if (needed > 0) {
+		mapped = reinterpret_cast< uint8_t * >(glMapBufferRange(GL_UNIFORM_BUFFER, segment * segment_size, needed,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		if (!mapped) {
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			throw std::runtime_error("Failed to map uniform ring buffer.");
+		}
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformRing::end() {
+	if (!mapped) return;
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	mapped = nullptr;
+}
+
+void UniformRing::bind(GLuint binding, uint32_t i) const {
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, segment * segment_size + i * stride, block_size);
+}
+
+void UniformRing::fence() {
+	if (fences[segment]) glDeleteSync(fences[segment]);
+	fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+
+//Helpers for feeding std140 uniform blocks from the CPU.
+
+//"UniformBlock" holds a single block that is re-uploaded (e.g.) once per frame:
+struct UniformBlock {
+	UniformBlock() = default;
+	UniformBlock(UniformBlock const &) = delete;
+	~UniformBlock();
+
+	//upload 'size' bytes from 'data' (orphaning the old contents) and bind to 'binding':
+	void set(void const *data, GLsizeiptr size, GLuint binding);
+
+	GLuint buffer = 0; //created on first set()
+};
+
+//"UniformRing" holds per-draw blocks (e.g., object matrices) for a whole frame:
+// the buffer is split into several segments so the CPU can write one frame's blocks
+// while the GPU is still reading earlier frames'; fences keep the two from overlapping.
+struct UniformRing {
+	UniformRing() = default;
+	UniformRing(UniformRing const &) = delete;
+	~UniformRing();
+
+	//map space for 'count' blocks of 'size' bytes each (grows buffer if needed):
+	void begin(uint32_t count, GLsizeiptr size);
+	//pointer to the i'th block being written (valid between begin() and end()):
+	void *block(uint32_t i) {
+		return mapped + i * stride;
+	}
+	//unmap the written blocks:
+	void end();
+
+	//bind the i'th block written this frame to 'binding':
+	void bind(GLuint binding, uint32_t i) const;
+
+	//call after issuing all draws that use this frame's blocks:
+	void fence();
+
+	static constexpr uint32_t Segments = 3;
+	GLuint buffer = 0; //created on first begin()
+	GLsizeiptr stride = 0; //block size rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	GLsizeiptr block_size = 0; //size of each block
+	GLsizeiptr segment_size = 0; //bytes in each segment
+	uint32_t segment = 0; //segment being written
+	GLsync fences[Segments] = {0, 0, 0};
+	uint8_t *mapped = nullptr;
+};
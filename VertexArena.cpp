@@ -0,0 +1,98 @@
+#include "VertexArena.hpp"
+
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+constexpr GLuint VertexArena::DefaultVertexCapacity;
+constexpr GLuint VertexArena::DefaultIndexCapacity;
+
+VertexArena::VertexArena(MeshBuffer const &layout, GLuint vertex_capacity_, GLuint index_capacity_)
+	: Position(layout.Position), Normal(layout.Normal), Color(layout.Color), TexCoord(layout.TexCoord),
+	  stride(layout.Position.stride), vertex_capacity(vertex_capacity_), index_capacity(index_capacity_) {
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(vertex_capacity) * stride, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(index_capacity) * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+VertexArena::~VertexArena() {
+	for (auto const &pv : vaos) {
+		glDeleteVertexArrays(1, &pv.second);
+	}
+	vaos.clear();
+	if (ebo != 0) {
+		glDeleteBuffers(1, &ebo);
+		ebo = 0;
+	}
+	if (vbo != 0) {
+		glDeleteBuffers(1, &vbo);
+		vbo = 0;
+	}
+}
+
+GLuint VertexArena::add_vertices(void const *data, GLuint count) {
+	if (count > vertex_capacity - vertex_count) {
+		throw std::runtime_error("VertexArena has no room for " + std::to_string(count) + " vertices.");
+	}
+	GLuint first = vertex_count;
+	if (count > 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(first) * stride, GLsizeiptr(count) * stride, data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	vertex_count += count;
+	return first;
+}
+
+GLuint VertexArena::add_indices(GLuint const *data, GLuint count, GLuint base_vertex) {
+	if (count > index_capacity - index_count) {
+		throw std::runtime_error("VertexArena has no room for " + std::to_string(count) + " indices.");
+	}
+	GLuint first = index_count;
+	if (count > 0) {
+		//indices refer to the arena's vertices, so are offset to where their vertices went:
+		std::vector< GLuint > offset(data, data + count);
+		if (base_vertex != 0) {
+			for (auto &i : offset) i += base_vertex;
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(first) * sizeof(GLuint), GLsizeiptr(count) * sizeof(GLuint), offset.data());
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	index_count += count;
+	return first;
+}
+
+static bool same_attrib(MeshBuffer::Attrib const &a, MeshBuffer::Attrib const &b) {
+	return a.size == b.size && a.type == b.type && a.normalized == b.normalized && a.stride == b.stride && a.offset == b.offset;
+}
+
+bool VertexArena::has_layout(MeshBuffer const &layout) const {
+	return same_attrib(Position, layout.Position)
+	    && same_attrib(Normal, layout.Normal)
+	    && same_attrib(Color, layout.Color)
+	    && same_attrib(TexCoord, layout.TexCoord);
+}
+
+VertexArena &VertexArena::acquire(MeshBuffer const &layout, GLuint vertices, GLuint indices) {
+	static std::vector< VertexArena * > arenas; //(never freed, like Load<>'ed data)
+	for (auto const &arena : arenas) {
+		if (arena->has_layout(layout)
+		 && vertices <= arena->vertex_capacity - arena->vertex_count
+		 && indices <= arena->index_capacity - arena->index_count) {
+			return *arena;
+		}
+	}
+	arenas.emplace_back(new VertexArena(layout,
+		std::max(vertices, DefaultVertexCapacity),
+		std::max(indices, DefaultIndexCapacity)
+	));
+	return *arenas.back();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MeshBuffer.hpp"
+#include "GL.hpp"
+
+#include <map>
+
+//"VertexArena" is a large vertex buffer (plus element buffer) that MeshBuffers with the same vertex layout
+// are loaded into one after another (see MeshBuffer::SharedArena), so that meshes from all of them
+// can be drawn from one vao per program (and so without vao switches).
+
+struct VertexArena {
+	//create buffers with room for the given numbers of vertices and indices, for data laid out like 'layout':
+	VertexArena(MeshBuffer const &layout, GLuint vertex_capacity, GLuint index_capacity);
+	~VertexArena();
+	VertexArena(VertexArena const &) = delete;
+
+	//copy 'count' vertices into the arena, returning the index of the first:
+	// note: will throw if the arena is full.
+	GLuint add_vertices(void const *data, GLuint count);
+
+	//copy 'count' indices into the arena (adding 'base_vertex' to each), returning the offset of the first:
+	// note: will throw if the arena is full.
+	GLuint add_indices(GLuint const *data, GLuint count, GLuint base_vertex);
+
+	//an arena for 'layout' with room for 'vertices' and 'indices' (a new one is created if none has room):
+	// (arenas live until the program exits, like other loaded data)
+	static VertexArena &acquire(MeshBuffer const &layout, GLuint vertices, GLuint indices);
+	static constexpr GLuint DefaultVertexCapacity = 1 << 18;
+	static constexpr GLuint DefaultIndexCapacity = 1 << 20;
+
+	bool has_layout(MeshBuffer const &layout) const;
+
+	MeshBuffer::Attrib Position;
+	MeshBuffer::Attrib Normal;
+	MeshBuffer::Attrib Color;
+	MeshBuffer::Attrib TexCoord;
+	GLsizei stride = 0;
+
+	GLuint vbo = 0;
+	GLuint ebo = 0;
+	GLuint vertex_capacity = 0;
+	GLuint vertex_count = 0;
+	GLuint index_capacity = 0;
+	GLuint index_count = 0;
+
+	std::map< MeshBuffer::AttribLocations, GLuint > vaos; //shared by all buffers in the arena (made by MeshBuffer::make_vao_for_program)
+};
@@ -0,0 +1,76 @@
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool(uint32_t count) : next(0) {
+	threads.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		threads.emplace_back([this](){
+			uint32_t seen = 0;
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				wake.wait(lock, [&](){ return quit || generation != seen; });
+				if (quit) break;
+				seen = generation;
+				++busy;
+				lock.unlock();
+				run_job();
+				lock.lock();
+				--busy;
+				idle.notify_all();
+			}
+		});
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+uint32_t WorkerPool::default_threads() {
+	uint32_t hardware = std::thread::hardware_concurrency();
+	return (hardware > 1 ? hardware - 1 : 0);
+}
+
+void WorkerPool::run_job() {
+	//NOTE: job fields are only changed while busy == 0, so they can be read here without the lock
+	while (true) {
+		uint32_t begin = next.fetch_add(job_grain);
+		if (begin >= job_count) break;
+		uint32_t end = (job_count - begin > job_grain ? begin + job_grain : job_count);
+		(*job)(begin, end);
+	}
+}
+
+void WorkerPool::parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &fn) {
+	if (grain == 0) grain = 1;
+	if (threads.empty() || count <= grain) {
+		if (count > 0) fn(0, count);
+		return;
+	}
+
+	{ //publish job (once any workers from the last job are out of run_job()):
+		std::unique_lock< std::mutex > lock(mutex);
+		idle.wait(lock, [this](){ return busy == 0; });
+		job = &fn;
+		job_count = count;
+		job_grain = grain;
+		next = 0;
+		++generation;
+	}
+	wake.notify_all();
+
+	//help out:
+	run_job();
+
+	{ //wait for workers to finish their last ranges:
+		std::unique_lock< std::mutex > lock(mutex);
+		idle.wait(lock, [this](){ return busy == 0; });
+		job = nullptr;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+//"WorkerPool" keeps a few threads around to split up data-parallel loops:
+// (e.g., Scene uses one to compute object matrices)
+
+struct WorkerPool {
+	//start 'threads' worker threads;
+	// the thread calling parallel_for() also does work, so zero threads is valid (everything runs serially):
+	WorkerPool(uint32_t threads = default_threads());
+	~WorkerPool();
+	WorkerPool(WorkerPool const &) = delete;
+
+	//call fn(begin, end) on ranges of at most 'grain' items covering [0, count), returning once all are done:
+	// (fn is called from several threads at once, so it should only write to its own range)
+	void parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &fn);
+
+	//hardware threads minus one (for the calling thread):
+	static uint32_t default_threads();
+
+	//internals:
+	void run_job(); //claims ranges of the current job until none are left
+	std::vector< std::thread > threads;
+	std::mutex mutex;
+	std::condition_variable wake; //signaled when a job starts (or pool is quitting)
+	std::condition_variable idle; //signaled when a worker finishes a job
+	std::function< void(uint32_t, uint32_t) > const *job = nullptr;
+	uint32_t job_count = 0;
+	uint32_t job_grain = 1;
+	uint32_t generation = 0; //incremented for every job
+	uint32_t busy = 0; //workers currently inside run_job()
+	std::atomic< uint32_t > next; //next item to claim
+	bool quit = false;
+};
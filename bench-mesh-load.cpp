@@ -0,0 +1,162 @@
+//"bench-mesh-load" compares reading a large '.pnc'-style file's chunks the way MeshBuffer used to
+// (std::ifstream + read_chunk into a zero-filled std::vector) with MappedFile + ChunkReader (spans into the mapping).
+//Each load is followed by a pass over the vertex data, standing in for the copy glBufferData makes.
+// usage: bench-mesh-load [vertices] [iterations]
+//note: the file is written just before loading, so this measures loads from a warm page cache.
+
+#include "MappedFile.hpp"
+#include "read_chunk.hpp"
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::u8vec4 Color;
+};
+static_assert(sizeof(Vertex) == 3*4+3*4+4*1, "Vertex is packed.");
+
+//peak resident set size so far, in megabytes (or -1 where not available):
+static double peak_rss_mb() {
+	#ifdef _WIN32
+	return -1.0;
+	#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	#ifdef __APPLE__
+	return double(usage.ru_maxrss) / (1024.0 * 1024.0); //(bytes)
+	#else
+	return double(usage.ru_maxrss) / 1024.0; //(kilobytes)
+	#endif
+	#endif
+}
+
+//current anonymous (i.e., not file-backed) resident memory, in megabytes (or -1 where not available):
+// (mapped file pages count toward RSS, but are page cache that can be shared and dropped, unlike a heap copy)
+static double anonymous_rss_mb() {
+	#if defined(__linux__)
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0, 8, "RssAnon:") == 0) return double(std::atol(line.c_str() + 8)) / 1024.0; //(kilobytes)
+	}
+	#endif
+	return -1.0;
+}
+
+//stand-in for uploading: read every byte (so mapped pages are actually faulted in):
+static uint32_t consume(void const *data, size_t size) {
+	uint32_t sum = 0;
+	uint8_t const *bytes = reinterpret_cast< uint8_t const * >(data);
+	for (size_t i = 0; i < size; i += 64) sum += bytes[i];
+	return sum;
+}
+
+int main(int argc, char **argv) {
+	uint32_t vertex_count = 4000000;
+	uint32_t iterations = 5;
+	if (argc > 1) vertex_count = uint32_t(std::atoi(argv[1]));
+	if (argc > 2) iterations = uint32_t(std::atoi(argv[2]));
+	if (vertex_count == 0 || iterations == 0) {
+		std::cerr << "usage: " << argv[0] << " [vertices] [iterations]" << std::endl;
+		return 1;
+	}
+
+	std::string filename = "bench-mesh-load.tmp.pnc";
+	{ //write a mesh file with one big mesh (a block at a time, so writing doesn't raise peak RSS):
+		std::ofstream out(filename, std::ios::binary);
+		auto write_header = [&out](char const *magic, uint32_t size) {
+			out.write(magic, 4);
+			out.write(reinterpret_cast< char const * >(&size), 4);
+		};
+		write_header("pnc.", vertex_count * uint32_t(sizeof(Vertex)));
+		std::vector< Vertex > block;
+		for (uint32_t begin = 0; begin < vertex_count; begin += 4096) {
+			block.clear();
+			for (uint32_t i = begin; i < std::min(vertex_count, begin + 4096); ++i) {
+				Vertex v;
+				v.Position = glm::vec3(float(i % 1000), float(i / 1000), 0.0f);
+				v.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+				v.Color = glm::u8vec4(0xff);
+				block.emplace_back(v);
+			}
+			out.write(reinterpret_cast< char const * >(block.data()), block.size() * sizeof(Vertex));
+		}
+		write_header("str0", 3);
+		out.write("Big", 3);
+		uint32_t index[4] = {0, 3, 0, vertex_count};
+		write_header("idx0", sizeof(index));
+		out.write(reinterpret_cast< char const * >(index), sizeof(index));
+		if (!out) {
+			std::cerr << "Failed to write '" << filename << "'." << std::endl;
+			return 1;
+		}
+	}
+
+	std::cout << "before loading: peak RSS " << std::fixed << std::setprecision(1) << peak_rss_mb() << " MB" << std::endl;
+	std::cout << vertex_count << " vertices ("
+		<< double(vertex_count) * sizeof(Vertex) / (1024.0 * 1024.0) << " MB), " << iterations << " iterations." << std::endl;
+	std::cout << "  reader  ms/load  peak RSS (MB)  anonymous RSS while loaded (MB)" << std::endl;
+
+	uint32_t checksum = 0;
+	double anonymous = 0.0; //(sampled by loads, while their data is still around)
+	auto run = [&](char const *name, std::function< void() > const &load) {
+		std::vector< double > times;
+		anonymous = 0.0;
+		for (uint32_t iter = 0; iter < iterations; ++iter) {
+			auto before = std::chrono::high_resolution_clock::now();
+			load();
+			auto after = std::chrono::high_resolution_clock::now();
+			times.emplace_back(std::chrono::duration< double, std::milli >(after - before).count());
+		}
+		std::sort(times.begin(), times.end());
+		std::cout << std::setw(8) << name << "  " << std::setw(7) << std::setprecision(2) << times[times.size() / 2]
+			<< "  " << std::setw(13) << std::setprecision(1) << peak_rss_mb()
+			<< "  " << std::setw(32) << anonymous << std::endl;
+	};
+
+	//(mapped first, since peak RSS only ever grows)
+	run("mapped", [&](){
+		MappedFile file(filename);
+		ChunkReader chunks(file);
+		Span< Vertex > data = chunks.map_chunk< Vertex >("pnc.");
+		checksum += consume(data.data, data.size * sizeof(Vertex));
+		anonymous = std::max(anonymous, anonymous_rss_mb());
+		Span< char > strings = chunks.map_chunk< char >("str0");
+		std::vector< uint32_t > index;
+		chunks.read_chunk("idx0", &index);
+		checksum += uint32_t(strings.size + index.size());
+	});
+
+	run("stream", [&](){
+		std::ifstream file(filename, std::ios::binary);
+		std::vector< Vertex > data;
+		read_chunk(file, "pnc.", &data);
+		checksum += consume(data.data(), data.size() * sizeof(Vertex));
+		anonymous = std::max(anonymous, anonymous_rss_mb());
+		std::vector< char > strings;
+		read_chunk(file, "str0", &strings);
+		std::vector< uint32_t > index;
+		read_chunk(file, "idx0", &index);
+		checksum += uint32_t(strings.size() + index.size());
+	});
+
+	std::remove(filename.c_str());
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+
+	return 0;
+}
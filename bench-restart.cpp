@@ -0,0 +1,124 @@
+//"bench-restart" times Scene::clear() + re-building a level-sized scene (as CratesMode does on "TRY AGAIN"),
+// and counts heap allocations to check that restarts re-use pooled memory.
+// usage: bench-restart [platforms] [iterations]
+
+#include "Scene.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+//count every allocation made through operator new:
+static uint64_t allocations = 0;
+void *operator new(std::size_t size) {
+	++allocations;
+	void *ret = std::malloc(size ? size : 1);
+	if (!ret) throw std::bad_alloc();
+	return ret;
+}
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+void *operator new[](std::size_t size) {
+	++allocations;
+	void *ret = std::malloc(size ? size : 1);
+	if (!ret) throw std::bad_alloc();
+	return ret;
+}
+void operator delete[](void *ptr) noexcept {
+	std::free(ptr);
+}
+
+int main(int argc, char **argv) {
+	uint32_t platform_count = 600;
+	uint32_t iterations = 200;
+	if (argc > 1) platform_count = uint32_t(std::atoi(argv[1]));
+	if (argc > 2) iterations = uint32_t(std::atoi(argv[2]));
+	if (platform_count < 5 || iterations == 0) {
+		std::cerr << "usage: " << argv[0] << " [platforms (at least 5)] [iterations]" << std::endl;
+		return 1;
+	}
+
+	Scene scene;
+	std::mt19937 mt(0xbead);
+
+	//references into the scene, held (like CratesMode's) across restarts:
+	std::vector< Scene::Transform * > transforms;
+	std::vector< Scene::Object * > platforms;
+	std::vector< Scene::Object * > buttons;
+	transforms.reserve(platform_count);
+	platforms.reserve(platform_count);
+	buttons.reserve(5);
+
+	//roughly what CratesMode::initiate_game() does with the scene:
+	auto restart = [&]() {
+		transforms.clear();
+		platforms.clear();
+		buttons.clear();
+		scene.clear();
+
+		Scene::Transform *camera_transform = scene.new_transform();
+		scene.new_camera(camera_transform);
+
+		//platforms:
+		scene.new_transforms(platform_count, &transforms);
+		for (auto t : transforms) {
+			t->position = glm::vec3(mt() % 32, mt() % 32, (mt() % 5) * 0.5f);
+		}
+		scene.new_objects(transforms, &platforms);
+
+		//buttons on the first few platforms:
+		for (uint32_t i = 0; i < 5; ++i) {
+			Scene::Transform *t = scene.new_transform();
+			t->set_parent(transforms[i]);
+			buttons.emplace_back(scene.new_object(t));
+		}
+
+		//platforms get baked into a few chunk objects:
+		for (auto object : platforms) {
+			scene.delete_object(object);
+		}
+		platforms.clear();
+		for (uint32_t i = 0; i < 36; ++i) {
+			platforms.emplace_back(scene.new_object(scene.new_transform()));
+		}
+
+		//enemies:
+		for (uint32_t i = 0; i < 5; ++i) {
+			scene.new_object(scene.new_transform());
+		}
+	};
+
+	{ //first build (pools grow):
+		uint64_t before_allocations = allocations;
+		auto before = std::chrono::high_resolution_clock::now();
+		restart();
+		auto after = std::chrono::high_resolution_clock::now();
+		std::cout << "first build: " << std::fixed << std::setprecision(3)
+			<< std::chrono::duration< double, std::milli >(after - before).count() << " ms, "
+			<< (allocations - before_allocations) << " allocations" << std::endl;
+	}
+
+	std::vector< double > times;
+	times.reserve(iterations);
+	uint64_t before_allocations = allocations;
+	for (uint32_t iter = 0; iter < iterations; ++iter) {
+		auto before = std::chrono::high_resolution_clock::now();
+		restart();
+		auto after = std::chrono::high_resolution_clock::now();
+		times.emplace_back(std::chrono::duration< double, std::milli >(after - before).count());
+	}
+	uint64_t restart_allocations = allocations - before_allocations;
+	std::sort(times.begin(), times.end());
+
+	std::cout << "restart (" << platform_count << " platforms, " << iterations << " iterations): "
+		<< std::fixed << std::setprecision(3) << times[times.size() / 2] << " ms median, "
+		<< times.back() << " ms max, "
+		<< std::setprecision(2) << (double(restart_allocations) / iterations) << " allocations per restart" << std::endl;
+
+	return (restart_allocations == 0 ? 0 : 1);
+}
@@ -0,0 +1,83 @@
+//"bench-scene" times Scene::prepare_draw (the sort + matrix phase of Scene::draw) with different worker pool sizes.
+// It makes no OpenGL calls, so it runs without a window.
+// usage: bench-scene [objects] [iterations]
+
+#include "Scene.hpp"
+#include "WorkerPool.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+	uint32_t object_count = 100000;
+	uint32_t iterations = 20;
+	if (argc > 1) object_count = uint32_t(std::atoi(argv[1]));
+	if (argc > 2) iterations = uint32_t(std::atoi(argv[2]));
+	if (object_count == 0 || iterations == 0) {
+		std::cerr << "usage: " << argv[0] << " [objects] [iterations]" << std::endl;
+		return 1;
+	}
+
+	//a shallow hierarchy of objects, like the crates scene but much bigger:
+	Scene scene;
+	std::mt19937 mt(0xfeedf00d);
+	std::uniform_real_distribution< float > coord(-100.0f, 100.0f);
+	std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+	std::vector< Scene::Transform * > transforms;
+	scene.new_transforms(object_count, &transforms);
+	for (uint32_t i = 0; i < object_count; ++i) {
+		Scene::Transform *t = transforms[i];
+		t->position = glm::vec3(coord(mt), coord(mt), coord(mt));
+		t->rotation = glm::normalize(glm::quat(unit(mt), unit(mt), unit(mt), unit(mt)));
+		t->scale = glm::vec3(1.0f + 0.5f * unit(mt));
+		if (i % 16 != 0) t->set_parent(transforms[(i / 16) * 16]); //every 16th transform is a root
+		Scene::Object *object = scene.new_object(t);
+		object->vao = i % 8;
+		object->count = 36;
+	}
+
+	Scene::Transform *camera_transform = scene.new_transform();
+	camera_transform->position = glm::vec3(0.0f, -150.0f, 50.0f);
+	Scene::Camera *camera = scene.new_camera(camera_transform);
+
+	uint32_t hardware = std::max(1U, std::thread::hardware_concurrency());
+	std::cout << object_count << " objects, " << iterations << " iterations, " << hardware << " hardware threads." << std::endl;
+	std::cout << "threads  ms/frame  speedup" << std::endl;
+
+	//thread counts to try: 1, 2, 4, ... and the hardware thread count:
+	std::vector< uint32_t > thread_counts;
+	for (uint32_t threads = 1; threads < hardware; threads *= 2) {
+		thread_counts.emplace_back(threads);
+	}
+	thread_counts.emplace_back(hardware);
+
+	double baseline = 0.0;
+	for (uint32_t threads : thread_counts) {
+		WorkerPool pool(threads - 1); //(calling thread also works)
+		scene.worker_pool = &pool;
+
+		scene.prepare_draw(camera); //warm up (allocates draw_list + snapshot items)
+
+		std::vector< double > times;
+		for (uint32_t iter = 0; iter < iterations; ++iter) {
+			auto before = std::chrono::high_resolution_clock::now();
+			scene.prepare_draw(camera);
+			auto after = std::chrono::high_resolution_clock::now();
+			times.emplace_back(std::chrono::duration< double, std::milli >(after - before).count());
+		}
+		std::sort(times.begin(), times.end());
+		double median = times[times.size() / 2];
+		if (threads == 1) baseline = median;
+
+		std::cout << std::setw(7) << threads << "  " << std::setw(8) << std::fixed << std::setprecision(3) << median
+			<< "  " << std::setw(6) << std::setprecision(2) << (baseline / median) << "x" << std::endl;
+
+		scene.worker_pool = nullptr;
+	}
+
+	return 0;
+}
@@ -0,0 +1,54 @@
+#include "draw_render_stats.hpp"
+
+#include "RenderStats.hpp"
+#include "draw_text.hpp"
+#include "GL.hpp"
+
+#include <string>
+
+//the font (menu.p) only has glyphs for '*' and 'A'-'Z', so numbers are drawn with look-alike letters:
+// (values always follow a label, so e.g. 'O' reads as zero)
+static std::string number(uint32_t value) {
+	static char const digit_glyphs[] = "OIZEASGTBP";
+	std::string ret = std::to_string(value);
+	for (auto &c : ret) {
+		c = digit_glyphs[c - '0'];
+	}
+	return ret;
+}
+
+void draw_render_stats(glm::uvec2 const &drawable_size) {
+	RenderStats avg = render_stats_average();
+	std::string lines[] = {
+		"MS " + number(uint32_t(render_stats_average_ms() + 0.5f)),
+		"DRAWS " + number(avg.draw_calls),
+		"TRIS " + number(avg.triangles),
+		"PROGRAMS " + number(avg.program_switches),
+		"VAOS " + number(avg.vao_switches),
+		"UNIFORMS " + number(avg.uniform_calls),
+		"BLOCKS " + number(avg.block_binds),
+		"UPLOADS " + number(avg.buffer_uploads),
+		"KB " + number((avg.upload_bytes + 512) / 1024),
+		//shaded samples per hundred pixels (i.e., percent of the screen; over one hundred means overdraw):
+		"FILL " + number(avg.sampled_pixels ? uint32_t((100.0 * avg.samples_shaded) / double(avg.sampled_pixels) + 0.5) : 0),
+	};
+
+	//the overlay's own draws aren't counted, so that showing it doesn't change the numbers it shows:
+	RenderStats const frame_stats = render_stats;
+
+	glDisable(GL_DEPTH_TEST);
+
+	float height = 0.05f;
+	float right = float(drawable_size.x) / float(drawable_size.y) - 0.02f;
+	float y = 0.99f - height;
+	for (auto const &line : lines) {
+		float width = text_width(line, height);
+		draw_text(line, glm::vec2(right - width, y + 0.01f), height, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
+		draw_text(line, glm::vec2(right - width, y), height, glm::vec4(1.0f, 1.0f, 0.5f, 1.0f));
+		y -= 1.4f * height;
+	}
+
+	glEnable(GL_DEPTH_TEST);
+
+	render_stats = frame_stats;
+}
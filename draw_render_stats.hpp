@@ -0,0 +1,7 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+//Draws the rolling averages from RenderStats.hpp (via draw_text) in the top right of the screen:
+// (the overlay's draws are left out of render_stats)
+void draw_render_stats(glm::uvec2 const &drawable_size);
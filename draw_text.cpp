@@ -5,14 +5,32 @@
 #include "MeshBuffer.hpp"
 #include "data_path.hpp"
 #include "compile_program.hpp"
+#include "RenderStats.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <stdexcept>
+
 //------------ resources ------------
+//glyph mesh for each character (resolved once, so drawing does no name lookups; -1U where menu.p has no glyph):
+static MeshBuffer::Handle text_glyphs[128];
+
 Load< MeshBuffer > text_meshes(LoadTagInit, [](){
-	return new MeshBuffer(data_path("menu.p"));
+	MeshBuffer const *ret = new MeshBuffer(data_path("menu.p"));
+	for (uint32_t c = 0; c < 128; ++c) {
+		text_glyphs[c] = ret->find(std::string(1, char(c)));
+	}
+	return ret;
 });
 
+MeshBuffer::Mesh const &text_glyph(char c) {
+	MeshBuffer::Handle handle = (uint8_t(c) < 128 ? text_glyphs[uint8_t(c)] : -1U);
+	if (handle == -1U) {
+		throw std::runtime_error("Looking up mesh '" + std::string(1, c) + "' that doesn't exist.");
+	}
+	return text_meshes->lookup(handle);
+}
+
 //font metrics for "text_meshes":
 const constexpr float char_height = 3.0f;
 
@@ -79,6 +97,8 @@ void draw_text(std::string const &text, glm::vec2 const &anchor, float height, g
 void draw_text(std::string const &text, glm::mat4 const &transform, glm::vec4 color) {
 	glUseProgram(*text_program);
 	glBindVertexArray(*text_meshes_for_text_program);
+	render_stats.program_switches += 1;
+	render_stats.vao_switches += 1;
 
 	float x = 0.0f;
 	for (uint32_t i = 0; i < text.size(); ++i) {
@@ -94,8 +114,11 @@ void draw_text(std::string const &text, glm::mat4 const &transform, glm::vec4 co
 			glUniformMatrix4fv(text_program_mvp_mat4, 1, GL_FALSE, glm::value_ptr(mvp));
 			glUniform4fv(text_program_color_vec4, 1, glm::value_ptr(color));
 
-			MeshBuffer::Mesh const &mesh = text_meshes->lookup(text.substr(i,1));
-			glDrawArrays(GL_TRIANGLES, mesh.start, mesh.count);
+			MeshBuffer::Mesh const &mesh = text_glyph(text[i]);
+			mesh.draw();
+			render_stats.uniform_calls += 2;
+			render_stats.draw_calls += 1;
+			render_stats.triangles += mesh.count / 3;
 		}
 
 		x += char_width(text[i]);
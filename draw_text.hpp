@@ -1,5 +1,8 @@
 #pragma once
 
+#include "Load.hpp"
+#include "MeshBuffer.hpp"
+
 #include <glm/glm.hpp>
 
 #include <string>
@@ -14,3 +17,9 @@ void draw_text(std::string const &text, glm::mat4 const &transform, glm::vec4 co
 
 //compute the width drawn by 'draw_text' for a string:
 float text_width(std::string const &text, float height);
+
+//The font's glyph meshes (menu.p, named by character), for code that draws glyphs with its own program (e.g., MenuMode):
+extern Load< MeshBuffer > text_meshes;
+//glyph mesh for character 'c' (looked up without any searching):
+// note: will throw if the font has no glyph for 'c'.
+MeshBuffer::Mesh const &text_glyph(char c);
@@ -10,6 +10,18 @@
 //The 'Sound' header has functions for managing sound:
 #include "Sound.hpp"
 
+//Render statistics (counts of draw calls, etc) and an overlay to show them:
+#include "RenderStats.hpp"
+#include "draw_render_stats.hpp"
+
+//The render thread issues OpenGL calls while the main thread updates the next frame:
+#include "RenderThread.hpp"
+
+//Data files are loaded from an asset pack, if one has been built:
+#include "AssetPack.hpp"
+#include "MeshLoader.hpp"
+#include "data_path.hpp"
+
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
@@ -28,12 +40,18 @@
 #include <fstream>
 #include <memory>
 #include <algorithm>
+#include <functional>
 
 int main(int argc, char **argv) {
 	struct {
 		//TODO: this is where you set the title and size of your game window
 		std::string title = "TODO: Game Title";
 		glm::uvec2 size = glm::uvec2(640, 400);
+		#ifdef __APPLE__
+		bool render_thread = false; //(macOS wants OpenGL drawing + swapping on the main thread)
+		#else
+		bool render_thread = true; //draw on a separate thread, overlapping with the next update
+		#endif
 	} config;
 
 	//------------  initialization ------------
@@ -101,12 +119,37 @@ int main(int argc, char **argv) {
 
 	//------------ load assets --------------
 
+	//(files in dist/assets.pack -- see meshes/pack-assets.py -- are read from it; others from their own files)
+	if (mount_asset_pack(data_path("assets.pack"))) {
+		std::cout << "Loading from asset pack." << std::endl;
+	}
+
 	call_load_functions();
 
+	//background mesh loading (updated by every frame, on the thread that draws it):
+	std::unique_ptr< MeshLoader > loader(new MeshLoader());
+	mesh_loader = loader.get();
+
 	//------------ create game mode + make current --------------
 
 	Mode::set_current(std::make_shared< CratesMode >());
 
+	//------------ start render thread --------------
+	//(after loading, since loading -- and creating the first mode -- makes OpenGL objects on this thread)
+
+	std::unique_ptr< RenderThread > render_thread;
+	if (config.render_thread) {
+		try {
+			render_thread.reset(new RenderThread(window, context));
+		} catch (std::exception &e) {
+			std::cerr << "WARNING: drawing on the main thread (" << e.what() << ")." << std::endl;
+		}
+	}
+
+	//the mode drawn by the last frame; when it is replaced, it is released by the next frame
+	// (so, with a render thread, modes are destroyed on that thread, which is where their OpenGL objects can be deleted):
+	std::shared_ptr< Mode > drawn_mode;
+
 	//------------ main loop ------------
 
 	//the window created above is resizable; this inline function will be
@@ -121,10 +164,13 @@ int main(int argc, char **argv) {
 		window_size = glm::uvec2(w, h);
 		SDL_GL_GetDrawableSize(window, &w, &h);
 		drawable_size = glm::uvec2(w, h);
-		glViewport(0, 0, drawable_size.x, drawable_size.y);
+		//(viewport is set at the start of every frame, since the render thread may own the context)
 	};
 	on_resize();
 
+	//F3 toggles the render statistics overlay:
+	bool show_render_stats = false;
+
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
@@ -138,7 +184,9 @@ int main(int argc, char **argv) {
 					on_resize();
 				}
 				//handle input:
-				if (Mode::current && Mode::current->handle_event(evt, window_size)) {
+				if (evt.type == SDL_KEYDOWN && evt.key.keysym.scancode == SDL_SCANCODE_F3) {
+					show_render_stats = !show_render_stats;
+				} else if (Mode::current && Mode::current->handle_event(evt, window_size)) {
 					// mode handled it; great
 				} else if (evt.type == SDL_QUIT) {
 					Mode::set_current(nullptr);
@@ -148,11 +196,13 @@ int main(int argc, char **argv) {
 			if (!Mode::current) break;
 		}
 
+		float frame_elapsed = 0.0f; //(unclamped, for render stats)
 		{ //(2) call the current mode's "update" function to deal with elapsed time:
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
 			previous_time = current_time;
+			frame_elapsed = elapsed;
 
 			//if frames are taking a very long time to process,
 			//lag to avoid spiral of death:
@@ -162,24 +212,65 @@ int main(int argc, char **argv) {
 			if (!Mode::current) break;
 		}
 
-		{ //(3) call the current mode's "draw" function to produce output:
-			//clear the depth+color buffers and set some default state:
-			glClearColor(0.5, 0.5, 0.5, 0.0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		{ //(3) call the current mode's "draw" (or "prepare_draw") function to produce output:
+			std::shared_ptr< Mode > mode = Mode::current;
+			std::shared_ptr< Mode > retired;
+			if (drawn_mode != mode) {
+				retired = drawn_mode;
+				drawn_mode = mode;
+			}
 
-			Mode::current->draw(drawable_size);
-		}
+			std::function< void() > draw_mode;
+			if (render_thread) draw_mode = mode->prepare_draw(drawable_size);
+			bool lockstep = !draw_mode; //(mode draws from its own state, so can't overlap with update)
+			if (!draw_mode) {
+				draw_mode = [mode, drawable_size](){
+					mode->draw(drawable_size);
+				};
+			}
+
+			std::function< void() > frame = [draw_mode, retired, drawable_size, show_render_stats, frame_elapsed, window]() mutable {
+				glViewport(0, 0, drawable_size.x, drawable_size.y);
+
+				//clear the depth+color buffers and set some default state:
+				glClearColor(0.5, 0.5, 0.5, 0.0);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glEnable(GL_DEPTH_TEST);
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+				//copy meshes loaded in the background into their buffers:
+				mesh_loader->update();
+
+				draw_mode();
 
-		//Finally, wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+				if (show_render_stats) draw_render_stats(drawable_size);
+				render_stats_end_frame(frame_elapsed);
+
+				//Finally, wait until the recently-drawn frame is shown:
+				SDL_GL_SwapWindow(window);
+
+				retired.reset();
+			};
+			retired.reset(); //(frame holds the only reference now)
+
+			if (render_thread) {
+				render_thread->submit(std::move(frame));
+				if (lockstep) render_thread->finish();
+			} else {
+				frame();
+			}
+		}
 	}
 
 
 	//------------  teardown ------------
 
+	render_thread.reset(); //(finishes the last frame; context is current on this thread again)
+	drawn_mode.reset();
+	mesh_loader = nullptr;
+	loader.reset();
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
@@ -13,7 +13,7 @@ for i in range(0,len(sys.argv)):
 		args = sys.argv[i+1:]
 
 if len(args) != 2:
-	print("\n\nUsage:\nblender --background --python export-meshes.py -- <infile.blend>[:layer] <outfile.p[n][c][t][l]>\nExports the meshes referenced by all objects in layer (default 1) to a binary blob, indexed by the names of the objects that reference them. If 'l' is specified in the file extension, only mesh edges will be exported.\n")
+	print("\n\nUsage:\nblender --background --python export-meshes.py -- <infile.blend>[:layer] <outfile.p[n][c][t][l|q]>\nExports the meshes referenced by all objects in layer (default 1) to a binary blob, indexed by the names of the objects that reference them. Objects named 'Name_LOD1', 'Name_LOD2', ... (on any layer) are also exported, as levels of detail for 'Name'. Triangles are written as indices into de-duplicated vertices, ordered for vertex cache locality (see optimize_mesh.py), along with per-mesh bounds. If 'l' is specified in the file extension, only mesh edges will be exported (without indices). If 'q' is specified, positions are quantized to 16 bits (within per-mesh boxes) and normals are packed in 32 bits.\n")
 	exit(1)
 
 infile = args[0]
@@ -33,14 +33,17 @@ print("Will export meshes referenced from layer " + str(layer) + " of '" + infil
 class FileType:
 	def __init__(self, magic, as_lines = False):
 		self.magic = magic
-		self.position = (b"p" in magic)
-		self.normal = (b"n" in magic)
+		#(upper case 'P' and 'N' are quantized positions and packed normals, see MeshBuffer.hpp)
+		self.position = (b"p" in magic or b"P" in magic)
+		self.normal = (b"n" in magic or b"N" in magic)
 		self.color = (b"c" in magic)
 		self.texcoord = (b"t" in magic)
+		self.quantized = (b"P" in magic)
 		self.as_lines = as_lines
+		self.indexed = not as_lines #triangle meshes share identical vertices via an 'ind0' chunk
 		self.vertex_bytes = 0
-		if self.position: self.vertex_bytes += 3 * 4
-		if self.normal: self.vertex_bytes += 3 * 4
+		if self.position: self.vertex_bytes += (4 * 2 if self.quantized else 3 * 4) #(u16 x, y, z, padding)
+		if self.normal: self.vertex_bytes += (4 if self.quantized else 3 * 4) #(2_10_10_10)
 		if self.color: self.vertex_bytes += 4
 		if self.texcoord: self.vertex_bytes += 2 * 4
 
@@ -54,6 +57,9 @@ filetypes = {
 	".pct" : FileType(b"pct."),
 	".pnt" : FileType(b"pnt."),
 	".pnct" : FileType(b"pnct"),
+	".pnq" : FileType(b"PN.."),
+	".pncq" : FileType(b"PNc."),
+	".pnctq" : FileType(b"PNct"),
 }
 
 filetype = None
@@ -69,7 +75,12 @@ if filetype == None:
 	exit(1)
 
 import bpy
+import mathutils
 import struct
+import os
+
+sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+import optimize_mesh
 
 import argparse
 
@@ -78,10 +89,19 @@ bpy.ops.wm.open_mainfile(filepath=infile)
 
 
 
+#level-of-detail meshes: objects named 'Name_LOD1', 'Name_LOD2', ... (on any layer, so they can be kept out of sight)
+# are written under their object name as coarser versions of the mesh named 'Name' (see MeshBuffer::lookup_lods):
+lod_pattern = re.compile(r'^(.+)_LOD(\d+)$')
+lod_objects = []
+for obj in bpy.data.objects:
+	m = lod_pattern.match(obj.name)
+	if m and obj.type == 'MESH' and int(m.group(2)) >= 1:
+		lod_objects.append(obj)
+
 #meshes to write:
 to_write = set()
 for obj in bpy.data.objects:
-	if obj.layers[layer-1] and obj.type == 'MESH':
+	if obj.layers[layer-1] and obj.type == 'MESH' and obj not in lod_objects:
 		to_write.add(obj.data)
 
 #data contains vertex and normal data from the meshes:
@@ -90,18 +110,66 @@ data = b''
 #strings contains the mesh names:
 strings = b''
 
-#index gives offsets into the data (and names) for each mesh:
+#elements contains (32-bit) indices into data, for indexed files:
+elements = b''
+
+#index gives offsets into the data -- or, for indexed files, the elements -- (and names) for each mesh:
 index = b''
 
-vertex_count = 0
+#objects to write, paired with the name to write them under:
+exports = []
 for obj in bpy.data.objects:
 	if obj.data in to_write:
 		to_write.remove(obj.data)
-	else:
-		continue
+		exports.append((obj, obj.data.name))
+for obj in lod_objects:
+	exports.append((obj, obj.name))
+
+#check that levels of detail have a base mesh and don't skip levels:
+written_names = set(name for (obj, name) in exports)
+for obj in lod_objects:
+	m = lod_pattern.match(obj.name)
+	base = m.group(1)
+	level = int(m.group(2))
+	if base not in written_names:
+		print("WARNING: level-of-detail object '" + obj.name + "' has no base mesh named '" + base + "'.")
+	elif level > 1 and (base + "_LOD" + str(level-1)) not in written_names:
+		print("WARNING: level-of-detail object '" + obj.name + "' skips a level; it will not be found by MeshBuffer::lookup_lods.")
+
+#quantization boxes (object-space min corner and size) for quantized files, by name:
+# (levels of detail use their base mesh's box -- grown to fit them -- so that objects can switch levels without changing dequantization)
+def box_name(obj, name):
+	if obj in lod_objects:
+		return lod_pattern.match(obj.name).group(1)
+	return name
+
+boxes = dict()
+if filetype.quantized:
+	for (obj, name) in exports:
+		evaluated = obj.to_mesh(bpy.context.scene, True, 'PREVIEW') #(with modifiers applied, as below)
+		lo = [float('inf')] * 3
+		hi = [float('-inf')] * 3
+		for vertex in evaluated.vertices:
+			for c in range(0,3):
+				lo[c] = min(lo[c], vertex.co[c])
+				hi[c] = max(hi[c], vertex.co[c])
+		bpy.data.meshes.remove(evaluated)
+		key = box_name(obj, name)
+		if key in boxes:
+			lo = [min(a, b) for (a, b) in zip(lo, boxes[key][0])]
+			hi = [max(a, b) for (a, b) in zip(hi, boxes[key][1])]
+		boxes[key] = (lo, hi)
+
+#box data, written in the same order as the index:
+box_data = b''
+
+#bounds data (box, sphere, triangle count, and surface area; see MeshBuffer::Bounds), also in index order:
+bounds_data = b''
 
+vertex_count = 0
+element_count = 0
+for (obj, name) in exports:
 	mesh = obj.data
-	name = mesh.name
 
 	print("Writing '" + name + "'...")
 	if bpy.context.mode == 'EDIT':
@@ -134,9 +202,19 @@ for obj in bpy.data.objects:
 	index += struct.pack('I', name_begin)
 	index += struct.pack('I', name_end)
 
-	index += struct.pack('I', vertex_count) #vertex_begin
+	if filetype.indexed:
+		index += struct.pack('I', element_count) #vertex_begin (index of first element)
+	else:
+		index += struct.pack('I', vertex_count) #vertex_begin
 	#...count will be written below
 
+	if filetype.quantized:
+		(lo, hi) = boxes[box_name(obj, name)]
+		if lo[0] > hi[0]: (lo, hi) = ([0.0] * 3, [0.0] * 3) #(empty mesh)
+		size = [(h - l if h > l else 1.0) for (l, h) in zip(lo, hi)] #(so flat boxes don't divide by zero)
+		box_data += struct.pack('fff', *lo)
+		box_data += struct.pack('fff', *size)
+
 	colors = None
 	if filetype.color:
 		if len(obj.data.vertex_colors) == 0:
@@ -152,31 +230,75 @@ for obj in bpy.data.objects:
 			uvs = obj.data.uv_layers.active.data
 
 	if not filetype.as_lines:
-		#write the mesh triangles:
+		#gather the mesh triangles, keeping each distinct vertex (within this mesh) only once:
+		vertex_ids = dict()
+		mesh_vertices = []
+		positions = []
+		indices = []
 		for poly in mesh.polygons:
 			assert(len(poly.loop_indices) == 3)
 			for i in range(0,3):
 				assert(mesh.loops[poly.loop_indices[i]].vertex_index == poly.vertices[i])
 				loop = mesh.loops[poly.loop_indices[i]]
 				vertex = mesh.vertices[loop.vertex_index]
-				for x in vertex.co:
-					data += struct.pack('f', x)
+				attribs = b''
+				if filetype.quantized:
+					q = [min(65535, max(0, int(round((vertex.co[c] - lo[c]) / size[c] * 65535)))) for c in range(0,3)]
+					attribs += struct.pack('HHHH', q[0], q[1], q[2], 0)
+				else:
+					for x in vertex.co:
+						attribs += struct.pack('f', x)
 				if filetype.normal:
-					for x in loop.normal:
-						data += struct.pack('f', x)
+					if filetype.quantized:
+						n = [min(511, max(-511, int(round(x * 511)))) & 0x3ff for x in loop.normal]
+						attribs += struct.pack('I', n[0] | (n[1] << 10) | (n[2] << 20))
+					else:
+						for x in loop.normal:
+							attribs += struct.pack('f', x)
 				if filetype.color:
 					if colors != None:
 						col = colors[poly.loop_indices[i]].color
-						data += struct.pack('BBBB', int(col.r * 255), int(col.g * 255), int(col.b * 255), 255)
+						attribs += struct.pack('BBBB', int(col.r * 255), int(col.g * 255), int(col.b * 255), 255)
 					else:
-						data += struct.pack('BBBB', 255, 255, 255, 255)
+						attribs += struct.pack('BBBB', 255, 255, 255, 255)
 				if filetype.texcoord:
 					if uvs != None:
 						uv = uvs[poly.loop_indices[i]].uv
-						data += struct.pack('ff', uv.x, uv.y)
+						attribs += struct.pack('ff', uv.x, uv.y)
 					else:
-						data += struct.pack('ff', 0, 0)
-		vertex_count += len(mesh.polygons) * 3
+						attribs += struct.pack('ff', 0, 0)
+				if attribs not in vertex_ids:
+					vertex_ids[attribs] = len(mesh_vertices)
+					mesh_vertices.append(attribs)
+					positions.append(tuple(vertex.co))
+				indices.append(vertex_ids[attribs])
+		print("  " + str(len(mesh_vertices)) + " vertices (of " + str(len(mesh.polygons) * 3) + " triangle corners).")
+
+		#reorder triangles and vertices for the post-transform vertex cache (see optimize_mesh.py):
+		(new_indices, old_vertices) = optimize_mesh.optimize(indices, positions)
+		print("  ACMR " + "%.3f" % optimize_mesh.acmr(indices) + " -> " + "%.3f" % optimize_mesh.acmr(new_indices) + ".")
+		for v in old_vertices:
+			data += mesh_vertices[v]
+
+		#record object-space bounds:
+		lo = [min([p[c] for p in positions] + [float('inf')]) for c in range(0,3)]
+		hi = [max([p[c] for p in positions] + [float('-inf')]) for c in range(0,3)]
+		if len(positions) == 0: (lo, hi) = ([0.0] * 3, [0.0] * 3)
+		center = [0.5 * (l + h) for (l, h) in zip(lo, hi)]
+		radius = max([sum((p[c] - center[c]) ** 2 for c in range(0,3)) for p in positions] + [0.0]) ** 0.5
+		area = 0.0
+		for t in range(0, len(indices) // 3):
+			(a, b, c) = (positions[v] for v in indices[3*t:3*t+3])
+			area += 0.5 * (mathutils.Vector(b) - mathutils.Vector(a)).cross(mathutils.Vector(c) - mathutils.Vector(a)).length
+		bounds_data += struct.pack('fff', *lo)
+		bounds_data += struct.pack('fff', *hi)
+		bounds_data += struct.pack('ffff', *center, radius)
+		bounds_data += struct.pack('I', len(indices) // 3)
+		bounds_data += struct.pack('f', area)
+		for i in new_indices:
+			elements += struct.pack('I', vertex_count + i)
+		vertex_count += len(old_vertices)
+		element_count += len(mesh.polygons) * 3
 	else:
 		#write the mesh edges:
 		for edge in mesh.edges:
@@ -191,11 +313,15 @@ for obj in bpy.data.objects:
 				assert(not filetype.texcoord)
 		vertex_count += len(mesh.edges) * 2
 
-	index += struct.pack('I', vertex_count) #vertex_end
+	if filetype.indexed:
+		index += struct.pack('I', element_count) #vertex_end (index of last element + 1)
+	else:
+		index += struct.pack('I', vertex_count) #vertex_end
 
 
 #check that we wrote as much data as anticipated:
 assert(vertex_count * filetype.vertex_bytes == len(data))
+assert(element_count * 4 == len(elements))
 
 #write the data chunk and index chunk to an output blob:
 blob = open(outfile, 'wb')
@@ -203,15 +329,30 @@ blob = open(outfile, 'wb')
 blob.write(struct.pack('4s',filetype.magic)) #type
 blob.write(struct.pack('I', len(data))) #length
 blob.write(data)
-#second chunk: the strings
+#(for indexed files) next chunk: the elements
+if filetype.indexed:
+	blob.write(struct.pack('4s',b'ind0')) #type
+	blob.write(struct.pack('I', len(elements))) #length
+	blob.write(elements)
+#(for quantized files) next chunk: the boxes
+if filetype.quantized:
+	blob.write(struct.pack('4s',b'qbox')) #type
+	blob.write(struct.pack('I', len(box_data))) #length
+	blob.write(box_data)
+#next chunk: the strings
 blob.write(struct.pack('4s',b'str0')) #type
 blob.write(struct.pack('I', len(strings))) #length
 blob.write(strings)
-#third chunk: the index
+#next chunk: the index
 blob.write(struct.pack('4s',b'idx0')) #type
 blob.write(struct.pack('I', len(index))) #length
 blob.write(index)
+#(for triangle files) last chunk: the bounds
+if not filetype.as_lines:
+	blob.write(struct.pack('4s',b'bnd0')) #type
+	blob.write(struct.pack('I', len(bounds_data))) #length
+	blob.write(bounds_data)
 wrote = blob.tell()
 blob.close()
 
-print("Wrote " + str(wrote) + " bytes [== " + str(len(data)+8) + " bytes of data + " + str(len(strings)+8) + " bytes of strings + " + str(len(index)+8) + " bytes of index] to '" + outfile + "'")
+print("Wrote " + str(wrote) + " bytes [== " + str(len(data)+8) + " bytes of data + " + (str(len(elements)+8) + " bytes of elements + " if filetype.indexed else "") + str(len(strings)+8) + " bytes of strings + " + str(len(index)+8) + " bytes of index] to '" + outfile + "'")
@@ -0,0 +1,236 @@
+#!/usr/bin/env python
+
+#Triangle and vertex reordering for indexed meshes; used by 'export-meshes.py', and also runnable by itself:
+#python optimize_mesh.py <infile.p[n][c][t][q]> [outfile]
+# (reports vertex cache performance for each mesh in infile; if outfile is given, writes an indexed, optimized copy there)
+#
+#Triangles are ordered with 'Tipsify' (Sander, Nehab, and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007),
+# the resulting clusters are sorted so outward-facing parts of the mesh tend to be drawn first (the same paper's fast overdraw ordering),
+# and then vertices are renumbered in the order they are first used (so vertex fetches walk forward through memory).
+
+import struct
+import sys
+
+#post-transform vertex cache size assumed when ordering (and when reporting ACMR):
+CACHE_SIZE = 16
+
+#average cache miss ratio (vertex shader invocations per triangle) of 'indices' through a FIFO cache:
+def acmr(indices, cache_size = CACHE_SIZE):
+	if len(indices) == 0: return 0.0
+	cache = []
+	misses = 0
+	for v in indices:
+		if v not in cache:
+			misses += 1
+			cache.append(v)
+			if len(cache) > cache_size: cache.pop(0)
+	return misses / (len(indices) // 3)
+
+#reorder triangles for vertex cache locality;
+# returns (triangle order, index in that order of the first triangle of each cluster):
+def tipsify(indices, vertex_count, cache_size = CACHE_SIZE):
+	triangle_count = len(indices) // 3
+	adjacency = [[] for v in range(0, vertex_count)]
+	for t in range(0, triangle_count):
+		for v in indices[3*t:3*t+3]:
+			adjacency[v].append(t)
+	live = [len(a) for a in adjacency] #not-yet-emitted triangles using each vertex
+	timestamp = [0] * vertex_count #time each vertex last entered the cache
+	emitted = [False] * triangle_count
+	dead_end = [] #recently used vertices, for restarting when the fan runs out
+	order = []
+	clusters = []
+
+	time = cache_size + 1
+	scan = 0 #next vertex to check when dead_end is exhausted
+
+	def skip_dead_end():
+		nonlocal scan
+		while len(dead_end) != 0:
+			d = dead_end.pop()
+			if live[d] > 0: return d
+		while scan < vertex_count:
+			if live[scan] > 0: return scan
+			scan += 1
+		return -1
+
+	fan = skip_dead_end()
+	restart = True
+	while fan >= 0:
+		if restart:
+			clusters.append(len(order))
+			restart = False
+		candidates = []
+		for t in adjacency[fan]:
+			if emitted[t]: continue
+			emitted[t] = True
+			order.append(t)
+			for v in indices[3*t:3*t+3]:
+				dead_end.append(v)
+				candidates.append(v)
+				live[v] -= 1
+				if time - timestamp[v] > cache_size:
+					timestamp[v] = time
+					time += 1
+		#next fan: the candidate that will stay in the cache longest while its remaining triangles are emitted:
+		fan = -1
+		best = -1
+		for v in candidates:
+			if live[v] == 0: continue
+			priority = 0
+			if time - timestamp[v] + 2 * live[v] <= cache_size:
+				priority = time - timestamp[v]
+			if priority > best:
+				best = priority
+				fan = v
+		if fan == -1:
+			fan = skip_dead_end()
+			restart = True
+	assert(len(order) == triangle_count)
+	return (order, clusters)
+
+#sort clusters (ranges of 'order') so those facing away from the mesh center are drawn first;
+# they are more likely to occlude the rest of the mesh than be occluded by it:
+def sort_clusters(indices, positions, order, clusters):
+	def sub(a, b): return (a[0]-b[0], a[1]-b[1], a[2]-b[2])
+	def cross(a, b): return (a[1]*b[2]-a[2]*b[1], a[2]*b[0]-a[0]*b[2], a[0]*b[1]-a[1]*b[0])
+	def dot(a, b): return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]
+
+	#per-cluster area-weighted centroid and normal:
+	ranges = list(zip(clusters, clusters[1:] + [len(order)]))
+	centroids = []
+	normals = []
+	total = [0.0, 0.0, 0.0]
+	total_area = 0.0
+	for (begin, end) in ranges:
+		centroid = [0.0, 0.0, 0.0]
+		normal = [0.0, 0.0, 0.0]
+		area = 0.0
+		for t in order[begin:end]:
+			(a, b, c) = (positions[v] for v in indices[3*t:3*t+3])
+			n = cross(sub(b, a), sub(c, a)) #(length is twice the triangle's area)
+			w = dot(n, n) ** 0.5
+			for i in range(0,3):
+				normal[i] += n[i]
+				centroid[i] += w * (a[i] + b[i] + c[i]) / 3.0
+			area += w
+		for i in range(0,3): total[i] += centroid[i]
+		total_area += area
+		if area > 0.0: centroid = [x / area for x in centroid]
+		centroids.append(centroid)
+		normals.append(normal)
+	if total_area > 0.0: total = [x / total_area for x in total]
+
+	keys = [dot(sub(centroids[c], total), normals[c]) for c in range(0, len(ranges))]
+	sorted_order = []
+	for c in sorted(range(0, len(ranges)), key=lambda c: -keys[c]):
+		sorted_order += order[ranges[c][0]:ranges[c][1]]
+	return sorted_order
+
+#reorder the triangles in 'indices' (a list of vertex indices, three per triangle) and renumber vertices in first-use order;
+# returns (new indices, old vertex index for each new vertex index):
+def optimize(indices, positions):
+	vertex_count = len(positions)
+	(order, clusters) = tipsify(indices, vertex_count)
+	order = sort_clusters(indices, positions, order, clusters)
+
+	remap = [-1] * vertex_count
+	old_vertices = []
+	new_indices = []
+	for t in order:
+		for v in indices[3*t:3*t+3]:
+			if remap[v] == -1:
+				remap[v] = len(old_vertices)
+				old_vertices.append(v)
+			new_indices.append(remap[v])
+	#(unreferenced vertices are dropped)
+	return (new_indices, old_vertices)
+
+
+#---- command line: report on / optimize an existing mesh blob ----
+
+def read_chunks(filename):
+	chunks = []
+	with open(filename, 'rb') as f:
+		blob = f.read()
+	at = 0
+	while at < len(blob):
+		(magic, size) = struct.unpack_from('4sI', blob, at)
+		chunks.append((magic, blob[at+8:at+8+size]))
+		at += 8 + size
+	return chunks
+
+def vertex_bytes(magic):
+	quantized = (b"P" in magic)
+	size = 4 * 2 if quantized else 3 * 4
+	if b"n" in magic: size += 3 * 4
+	if b"N" in magic: size += 4
+	if b"c" in magic: size += 4
+	if b"t" in magic: size += 2 * 4
+	return size
+
+def main(args):
+	if len(args) < 1 or len(args) > 2 or args[0].endswith('.pl'):
+		print("\n\nUsage:\npython optimize_mesh.py <infile.p[n][c][t][q]> [outfile]\nReports the vertex cache miss ratio (ACMR, with a " + str(CACHE_SIZE) + " entry FIFO cache) of each mesh in a triangle mesh blob written by export-meshes.py, before and after optimization. If outfile is given, writes the optimized meshes there (as an indexed blob).\n")
+		exit(1)
+
+	chunks = read_chunks(args[0])
+	(magic, data) = chunks[0]
+	chunk = dict(chunks[1:])
+	stride = vertex_bytes(magic)
+	quantized = (b"P" in magic)
+	vertices = [data[i:i+stride] for i in range(0, len(data), stride)]
+	elements = None
+	if b'ind0' in chunk:
+		elements = list(struct.unpack(str(len(chunk[b'ind0']) // 4) + 'I', chunk[b'ind0']))
+	strings = chunk[b'str0']
+	entries = list(struct.iter_unpack('4I', chunk[b'idx0']))
+	boxes = list(struct.iter_unpack('6f', chunk[b'qbox'])) if quantized else None
+
+	out_data = b''
+	out_elements = []
+	out_index = b''
+	print("%-24s %10s %8s %8s %8s" % ("mesh", "triangles", "vertices", "before", "after"))
+	for (m, (name_begin, name_end, begin, end)) in enumerate(entries):
+		name = strings[name_begin:name_end].decode('utf8')
+		#gather this mesh's triangles as indices into its own (de-duplicated) vertices:
+		ids = dict()
+		mesh_vertices = []
+		indices = []
+		corners = elements[begin:end] if elements != None else range(begin, end)
+		for e in corners:
+			v = vertices[e]
+			if v not in ids:
+				ids[v] = len(mesh_vertices)
+				mesh_vertices.append(v)
+			indices.append(ids[v])
+		if quantized:
+			(ox, oy, oz, sx, sy, sz) = boxes[m]
+			positions = [(ox + sx * x / 65535.0, oy + sy * y / 65535.0, oz + sz * z / 65535.0) for (x, y, z, pad) in (struct.unpack_from('4H', v) for v in mesh_vertices)]
+		else:
+			positions = [struct.unpack_from('3f', v) for v in mesh_vertices]
+
+		(new_indices, old_vertices) = optimize(indices, positions)
+		print("%-24s %10d %8d %8.3f %8.3f" % (name, len(indices) // 3, len(mesh_vertices), acmr(indices), acmr(new_indices)))
+
+		base = len(out_data) // stride
+		for v in old_vertices:
+			out_data += mesh_vertices[v]
+		out_index += struct.pack('4I', name_begin, name_end, len(out_elements), len(out_elements) + len(new_indices))
+		out_elements += [base + i for i in new_indices]
+
+	if len(args) == 2:
+		with open(args[1], 'wb') as blob:
+			def write_chunk(magic, payload):
+				blob.write(struct.pack('4sI', magic, len(payload)))
+				blob.write(payload)
+			write_chunk(magic, out_data)
+			write_chunk(b'ind0', struct.pack(str(len(out_elements)) + 'I', *out_elements))
+			if quantized: write_chunk(b'qbox', chunk[b'qbox'])
+			write_chunk(b'str0', strings)
+			write_chunk(b'idx0', out_index)
+			if b'bnd0' in chunk: write_chunk(b'bnd0', chunk[b'bnd0']) #(bounds don't depend on ordering)
+			print("Wrote " + str(blob.tell()) + " bytes to '" + args[1] + "'")
+
+if __name__ == '__main__':
+	main(sys.argv[1:])
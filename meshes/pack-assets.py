@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+
+#Builds an asset pack (see AssetPack.hpp) from data files:
+#python pack-assets.py <outfile.pack> <file> [file ...]
+# files are named in the pack by their paths relative to the pack's directory (e.g., "crates.pnc" for dist/crates.pnc),
+# and stored in the order given -- list them in the order the game loads them, so loading reads the pack front-to-back.
+
+import os
+import struct
+import sys
+import zlib
+
+ALIGNMENT = 64 #(AssetPack::Alignment)
+
+args = sys.argv[1:]
+if len(args) < 2:
+	print("\n\nUsage:\npython pack-assets.py <outfile.pack> <file> [file ...]\nWrites the files into an asset pack, named by their paths relative to the pack's directory.\n")
+	exit(1)
+
+outfile = args[0]
+root = os.path.dirname(os.path.abspath(outfile))
+
+files = []
+for infile in args[1:]:
+	name = os.path.relpath(os.path.abspath(infile), root).replace(os.sep, '/')
+	if name.startswith('../'):
+		print("ERROR: '" + infile + "' is not inside the pack's directory ('" + root + "').")
+		exit(1)
+	if name in (f[0] for f in files):
+		print("ERROR: '" + name + "' is listed more than once.")
+		exit(1)
+	with open(infile, 'rb') as f:
+		files.append((name, f.read()))
+
+def pad(offset):
+	return (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT
+
+#names, in table-of-contents (sorted) order:
+by_name = sorted(range(0, len(files)), key=lambda i: files[i][0])
+names = b''
+name_ranges = dict()
+for i in by_name:
+	begin = len(names)
+	names += bytes(files[i][0], 'utf8')
+	name_ranges[i] = (begin, len(names))
+
+#payload offsets, in the order given:
+offset = 16 + 32 * len(files) + len(names)
+offset += pad(offset)
+offsets = dict()
+for i in range(0, len(files)):
+	offsets[i] = offset
+	offset += len(files[i][1])
+	offset += pad(offset)
+
+toc = b''
+for i in by_name:
+	(name, data) = files[i]
+	toc += struct.pack('<IIQQII', name_ranges[i][0], name_ranges[i][1], offsets[i], len(data), zlib.crc32(data) & 0xffffffff, 0)
+toc += names
+
+blob = open(outfile, 'wb')
+blob.write(struct.pack('<4sIII', b'apk0', len(files), len(names), zlib.crc32(toc) & 0xffffffff))
+blob.write(toc)
+for i in range(0, len(files)):
+	blob.write(b'\0' * (offsets[i] - blob.tell()))
+	blob.write(files[i][1])
+wrote = blob.tell()
+blob.close()
+
+print("Wrote " + str(wrote) + " bytes [" + str(len(files)) + " files] to '" + outfile + "'")
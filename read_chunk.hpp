@@ -33,3 +33,14 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 		throw std::runtime_error("Failed to read chunk data.");
 	}
 }
+
+//returns the magic number of the next chunk without reading it (or "" if there are no more chunks):
+inline std::string peek_chunk(std::istream &from) {
+	std::streampos at = from.tellg();
+	char magic[4];
+	std::string ret;
+	if (from.read(magic, 4)) ret = std::string(magic, 4);
+	from.clear();
+	from.seekg(at);
+	return ret;
+}
@@ -5,27 +5,40 @@
 VertexColorProgram::VertexColorProgram() {
 	program = compile_program(
 		"#version 330\n"
-		"uniform mat4 object_to_clip;\n"
-		"uniform mat4x3 object_to_light;\n"
-		"uniform mat3 normal_to_light;\n"
+		"layout(std140) uniform Frame {\n"
+		"	mat4 world_to_clip;\n"
+		"	vec3 sun_direction;\n"
+		"	vec3 sun_color;\n"
+		"	vec3 sky_direction;\n"
+		"	vec3 sky_color;\n"
+		"};\n"
+		"layout(std140) uniform Object {\n"
+		"	mat4x3 object_to_light;\n"
+		"	mat3 normal_to_light;\n"
+		"};\n"
 		"layout(location=0) in vec4 Position;\n" //note: layout keyword used to make sure that the location-0 attribute is always bound to something
+		//(for quantized meshes, Scene includes dequantization in object_to_light; packed normals arrive as normalized vec4s)
+		"invariant gl_Position;\n" //(so depths match Scene's depth pre-pass exactly)
 		"in vec3 Normal;\n"
 		"in vec4 Color;\n"
 		"out vec3 position;\n"
 		"out vec3 normal;\n"
 		"out vec4 color;\n"
 		"void main() {\n"
-		"	gl_Position = object_to_clip * Position;\n"
 		"	position = object_to_light * Position;\n"
+		"	gl_Position = world_to_clip * vec4(position, 1.0);\n"
 		"	normal = normal_to_light * Normal;\n"
 		"	color = Color;\n"
 		"}\n"
 		,
 		"#version 330\n"
-		"uniform vec3 sun_direction;\n"
-		"uniform vec3 sun_color;\n"
-		"uniform vec3 sky_direction;\n"
-		"uniform vec3 sky_color;\n"
+		"layout(std140) uniform Frame {\n"
+		"	mat4 world_to_clip;\n"
+		"	vec3 sun_direction;\n"
+		"	vec3 sun_color;\n"
+		"	vec3 sky_direction;\n"
+		"	vec3 sky_color;\n"
+		"};\n"
 		"in vec3 position;\n"
 		"in vec3 normal;\n"
 		"in vec4 color;\n"
@@ -47,14 +60,10 @@ VertexColorProgram::VertexColorProgram() {
 		"}\n"
 	);
 
-	object_to_clip_mat4 = glGetUniformLocation(program, "object_to_clip");
-	object_to_light_mat4x3 = glGetUniformLocation(program, "object_to_light");
-	normal_to_light_mat3 = glGetUniformLocation(program, "normal_to_light");
-
-	sun_direction_vec3 = glGetUniformLocation(program, "sun_direction");
-	sun_color_vec3 = glGetUniformLocation(program, "sun_color");
-	sky_direction_vec3 = glGetUniformLocation(program, "sky_direction");
-	sky_color_vec3 = glGetUniformLocation(program, "sky_color");
+	frame_block = glGetUniformBlockIndex(program, "Frame");
+	if (frame_block != GL_INVALID_INDEX) glUniformBlockBinding(program, frame_block, Scene::FrameBinding);
+	object_block = glGetUniformBlockIndex(program, "Object");
+	if (object_block != GL_INVALID_INDEX) glUniformBlockBinding(program, object_block, Scene::ObjectBinding);
 }
 
 Load< VertexColorProgram > vertex_color_program(LoadTagInit, [](){
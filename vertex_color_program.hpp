@@ -1,18 +1,16 @@
 #include "GL.hpp"
 #include "Load.hpp"
+#include "Scene.hpp"
 
+//vertex_color_program reads its matrices and lighting from the std140 'Frame' and 'Object' uniform blocks
+// (layouts given by Scene::FrameUniforms and Scene::ObjectUniforms, bound to Scene::FrameBinding and Scene::ObjectBinding):
 struct VertexColorProgram {
 	//opengl program object:
 	GLuint program = 0;
 
-	//uniform locations:
-	GLuint object_to_clip_mat4 = -1U;
-	GLuint object_to_light_mat4x3 = -1U;
-	GLuint normal_to_light_mat3 = -1U;
-	GLuint sun_direction_vec3 = -1U;
-	GLuint sun_color_vec3 = -1U;
-	GLuint sky_direction_vec3 = -1U;
-	GLuint sky_color_vec3 = -1U;
+	//uniform block indices:
+	GLuint frame_block = -1U;
+	GLuint object_block = -1U;
 
 	VertexColorProgram();
 };